@@ -0,0 +1,462 @@
+#ifndef ASYNC_PATH_FINDER_H
+#define ASYNC_PATH_FINDER_H
+
+#include "PathFinder.hpp"
+#include "GridChangeListener.hpp"
+#include "SearchContext.hpp"
+#include "SearchStatistics.hpp"
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstring>
+
+using namespace std;
+using namespace sf;
+
+/// <summary>
+/// Runs the path queries of a PathFinder on a worker thread so the thread
+/// that owns the grid never waits for a search.
+///
+/// Each query gets a copy of the occupancy bits and terrain costs taken
+/// when it is made (shared by every query made at the same revision), and the worker
+/// searches the copy with a PathFinder of its own. The grid can be edited
+/// while a search runs, and any edit that changes passability cancels the
+/// queries made before it, since their paths would be stale.
+/// </summary>
+class AsyncPathFinder : public GridChangeListener
+{
+public:
+	/// <summary>
+	/// Handle to one query. Its result can be read once isDone is true.
+	/// </summary>
+	class Request
+	{
+	private:
+		friend class AsyncPathFinder;
+
+		Vector2i start;
+		Vector2i end;
+		bool includeDiagonals;
+		unsigned long long revision; // grid revision the query was made at
+		shared_ptr<const vector<uint64_t>> occupancyWords; // the grid at that revision
+		shared_ptr<const vector<unsigned char>> terrainCosts;
+		PathFinder::SearchEngine searchEngine;
+		PathFinder::Heuristic heuristic;
+
+		atomic<bool> cancelled;
+		atomic<bool> done;
+		mutex doneLock;
+		condition_variable doneChanged;
+		PathFinder::PathStatus status;
+		vector<Vector2i> path;
+		QueryStats stats;
+
+	public:
+		Request();
+
+		Vector2i getStart();
+
+		Vector2i getEnd();
+
+		bool getIncludeDiagonals();
+
+		unsigned long long getRevision();
+
+		void cancel();
+
+		bool isCancelled();
+
+		bool isDone();
+
+		void wait();
+
+		PathFinder::PathStatus getStatus();
+
+		const vector<Vector2i> *getPath();
+
+		const QueryStats *getStats();
+
+	private:
+		void finish(PathFinder::PathStatus status);
+	};
+
+private:
+	PathFinder *pathFinder;
+	PathFinder *searcher; // searches the copied grids, only used by the worker
+	unsigned long long searcherRevision; // revision of the grid copied into the searcher
+	SearchContext searchContext; // only used by the worker
+
+	// the copy of the grid given to new queries, made again after every edit
+	shared_ptr<const vector<uint64_t>> occupancyWords;
+	shared_ptr<const vector<unsigned char>> terrainCosts;
+	unsigned long long occupancyRevision;
+
+	thread worker;
+	mutex queueLock; // guards the members below
+	condition_variable workAvailable;
+	deque<shared_ptr<Request>> queued; // queries waiting for the worker, oldest first
+	shared_ptr<Request> running; // query the worker is searching, NULL if none
+	bool stopping;
+	SearchStatistics statistics; // work done by every query searched so far
+
+public:
+	AsyncPathFinder(PathFinder *pathFinder);
+
+	~AsyncPathFinder();
+
+	shared_ptr<Request> findPathAsync(Vector2i start, Vector2i end, bool includeDiagonals);
+
+	void cancelAll();
+
+	void getStatistics(SearchStatistics *copy);
+
+	void onCellChanged(int x, int y, GridValue oldVal, GridValue newVal) override;
+
+	void onTerrainChanged(int x, int y, int oldCost, int newCost) override;
+
+private:
+	void workerLoop();
+
+	void search(Request *request);
+
+	AsyncPathFinder(const AsyncPathFinder &other) = delete;
+
+	AsyncPathFinder &operator = (const AsyncPathFinder &other) = delete;
+};
+
+/// <summary>
+/// Create a query that hasn't run yet
+/// </summary>
+AsyncPathFinder::Request::Request()
+	: cancelled(false), done(false)
+{
+	includeDiagonals = true;
+	revision = 0;
+	searchEngine = PathFinder::SearchEngine::A_STAR;
+	heuristic = PathFinder::Heuristic::OCTILE;
+	status = PathFinder::PathStatus::CANCELLED;
+	stats = QueryStats();
+}
+
+/// <summary>
+/// Get the start of the query
+/// </summary>
+/// <returns>the grid position the path starts from</returns>
+Vector2i AsyncPathFinder::Request::getStart()
+{
+	return start;
+}
+
+/// <summary>
+/// Get the end of the query
+/// </summary>
+/// <returns>the grid position the path ends at</returns>
+Vector2i AsyncPathFinder::Request::getEnd()
+{
+	return end;
+}
+
+/// <summary>
+/// Get the diagonal mode of the query
+/// </summary>
+/// <returns>whether the path can move diagonally</returns>
+bool AsyncPathFinder::Request::getIncludeDiagonals()
+{
+	return includeDiagonals;
+}
+
+/// <summary>
+/// Get the revision of the grid the query searches
+/// </summary>
+/// <returns>the grid revision when the query was made</returns>
+unsigned long long AsyncPathFinder::Request::getRevision()
+{
+	return revision;
+}
+
+/// <summary>
+/// Stop the query. A search already running stops at its next expansion
+/// and the query finishes as CANCELLED.
+/// </summary>
+void AsyncPathFinder::Request::cancel()
+{
+	cancelled.store(true);
+}
+
+/// <summary>
+/// Check if the query has been cancelled
+/// </summary>
+/// <returns>true if cancel was called and false otherwise</returns>
+bool AsyncPathFinder::Request::isCancelled()
+{
+	return cancelled.load();
+}
+
+/// <summary>
+/// Check if the query has finished, without waiting
+/// </summary>
+/// <returns>true if the status and path can be read and false otherwise</returns>
+bool AsyncPathFinder::Request::isDone()
+{
+	return done.load(memory_order_acquire);
+}
+
+/// <summary>
+/// Wait for the query to finish
+/// </summary>
+void AsyncPathFinder::Request::wait()
+{
+	unique_lock<mutex> lock(doneLock);
+	doneChanged.wait(lock, [this] { return done.load(memory_order_acquire); });
+}
+
+/// <summary>
+/// Get the outcome of a finished query
+/// </summary>
+/// <returns>whether a path was found, or CANCELLED</returns>
+PathFinder::PathStatus AsyncPathFinder::Request::getStatus()
+{
+	return status;
+}
+
+/// <summary>
+/// Get the path of a finished query
+/// </summary>
+/// <returns>the grid positions of the path starting after the start and
+/// ending with the end, empty if no path was found</returns>
+const vector<Vector2i> *AsyncPathFinder::Request::getPath()
+{
+	return &path;
+}
+
+/// <summary>
+/// Get the work a finished query did
+/// </summary>
+/// <returns>the stats of the search, all zero if the query was cancelled before it ran</returns>
+const QueryStats *AsyncPathFinder::Request::getStats()
+{
+	return &stats;
+}
+
+/// <summary>
+/// Publish the outcome of the query and wake up anyone waiting for it
+/// </summary>
+/// <param name="status">whether a path was found, or CANCELLED</param>
+void AsyncPathFinder::Request::finish(PathFinder::PathStatus status)
+{
+	this->status = status;
+	if (status != PathFinder::PathStatus::FOUND)
+	{
+		path.clear();
+	}
+	{
+		lock_guard<mutex> lock(doneLock);
+		done.store(true, memory_order_release);
+	}
+	doneChanged.notify_all();
+}
+
+/// <summary>
+/// Start the worker thread and listen for changes to the grid
+/// </summary>
+/// <param name="pathFinder">the path finder whose grid is searched</param>
+AsyncPathFinder::AsyncPathFinder(PathFinder *pathFinder)
+{
+	this->pathFinder = pathFinder;
+	Grid<PathFinder::GridNode>* grid = pathFinder->getGrid();
+	searcher = new PathFinder(grid->getGridWidth(), grid->getGridHeight(), grid->getCellSize());
+	// the searcher's grid starts empty, so any copy has to be loaded into it
+	searcherRevision = ULLONG_MAX;
+	occupancyRevision = ULLONG_MAX;
+	stopping = false;
+
+	pathFinder->addChangeListener(this);
+	worker = thread(&AsyncPathFinder::workerLoop, this);
+}
+
+/// <summary>
+/// Cancel every query, stop the worker thread and stop listening for changes
+/// </summary>
+AsyncPathFinder::~AsyncPathFinder()
+{
+	pathFinder->removeChangeListener(this);
+	cancelAll();
+	{
+		lock_guard<mutex> lock(queueLock);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+	worker.join();
+	delete(searcher);
+}
+
+/// <summary>
+/// Queue a query for the worker. Must be called from the thread that edits
+/// the grid.
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <returns>a handle to the query's result</returns>
+shared_ptr<AsyncPathFinder::Request> AsyncPathFinder::findPathAsync(Vector2i start, Vector2i end,
+	bool includeDiagonals)
+{
+	// copy the grid once per revision, every query made until the next
+	// edit shares the copy
+	if (occupancyRevision != pathFinder->getRevision())
+	{
+		OccupancyGrid* occupancy = pathFinder->getOccupancy();
+		occupancyWords = make_shared<const vector<uint64_t>>(occupancy->getWords(),
+			occupancy->getWords() + occupancy->getWordCount());
+		Grid<PathFinder::GridNode>* grid = pathFinder->getGrid();
+		terrainCosts = make_shared<const vector<unsigned char>>(pathFinder->getTerrainCosts(),
+			pathFinder->getTerrainCosts() + grid->getGridWidth() * grid->getGridHeight());
+		occupancyRevision = pathFinder->getRevision();
+	}
+
+	shared_ptr<Request> request = make_shared<Request>();
+	request->start = start;
+	request->end = end;
+	request->includeDiagonals = includeDiagonals;
+	request->revision = occupancyRevision;
+	request->occupancyWords = occupancyWords;
+	request->terrainCosts = terrainCosts;
+	request->searchEngine = pathFinder->getSearchEngine();
+	request->heuristic = pathFinder->getHeuristic();
+	{
+		lock_guard<mutex> lock(queueLock);
+		queued.push_back(request);
+	}
+	workAvailable.notify_one();
+	return request;
+}
+
+/// <summary>
+/// Cancel every query that is queued or running
+/// </summary>
+void AsyncPathFinder::cancelAll()
+{
+	lock_guard<mutex> lock(queueLock);
+	for (int i = 0; i < queued.size(); i++)
+	{
+		queued[i]->cancel();
+	}
+	if (running != NULL)
+	{
+		running->cancel();
+	}
+}
+
+/// <summary>
+/// Copy the totals and histograms of every query the worker has searched
+/// </summary>
+/// <param name="copy">set to the statistics so far</param>
+void AsyncPathFinder::getStatistics(SearchStatistics *copy)
+{
+	lock_guard<mutex> lock(queueLock);
+	*copy = statistics;
+}
+
+/// <summary>
+/// Cancel every query once a cell changes passability, since they all
+/// searched the grid as it was before
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+/// <param name="oldVal">the value the cell had before</param>
+/// <param name="newVal">the value the cell has now</param>
+void AsyncPathFinder::onCellChanged(int /*x*/, int /*y*/, GridValue oldVal, GridValue newVal)
+{
+	if ((oldVal == GridValue::OCCUPIED) != (newVal == GridValue::OCCUPIED))
+	{
+		cancelAll();
+	}
+}
+
+/// <summary>
+/// Cancel every query once a cell's terrain cost changes, since their paths
+/// might no longer be the cheapest
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+/// <param name="oldCost">the terrain cost the cell had before</param>
+/// <param name="newCost">the terrain cost the cell has now</param>
+void AsyncPathFinder::onTerrainChanged(int /*x*/, int /*y*/, int /*oldCost*/, int /*newCost*/)
+{
+	cancelAll();
+}
+
+/// <summary>
+/// Answer queued queries until the AsyncPathFinder is destroyed
+/// </summary>
+void AsyncPathFinder::workerLoop()
+{
+	while (true)
+	{
+		shared_ptr<Request> request;
+		{
+			unique_lock<mutex> lock(queueLock);
+			running = NULL;
+			workAvailable.wait(lock, [this] { return stopping || !queued.empty(); });
+			if (stopping)
+			{
+				break;
+			}
+			request = queued.front();
+			queued.pop_front();
+			running = request;
+		}
+
+		search(request.get());
+	}
+
+	// nobody will run what is left, but its waiters still have to wake up
+	lock_guard<mutex> lock(queueLock);
+	for (int i = 0; i < queued.size(); i++)
+	{
+		queued[i]->finish(PathFinder::PathStatus::CANCELLED);
+	}
+	queued.clear();
+}
+
+/// <summary>
+/// Answer one query on the worker thread
+/// </summary>
+/// <param name="request">the query to answer</param>
+void AsyncPathFinder::search(Request *request)
+{
+	if (request->isCancelled())
+	{
+		request->finish(PathFinder::PathStatus::CANCELLED);
+		return;
+	}
+
+	// load the query's copy of the grid unless the searcher already has it
+	if (searcherRevision != request->revision)
+	{
+		const vector<uint64_t>& words = *request->occupancyWords;
+		memcpy(searcher->getOccupancy()->getWords(), words.data(), words.size() * sizeof(uint64_t));
+		memcpy(searcher->getTerrainCosts(), request->terrainCosts->data(), request->terrainCosts->size());
+		// the copy skipped setValAt, so the searcher's components are relabelled in one go
+		searcher->invalidateComponents();
+		searcherRevision = request->revision;
+	}
+	searcher->setSearchEngine(request->searchEngine);
+	searcher->setHeuristic(request->heuristic);
+
+	searchContext.setCancelFlag(&request->cancelled);
+	PathFinder::PathStatus status = searcher->findPath(request->start, request->end,
+		request->includeDiagonals, 0, &searchContext, &request->path, &request->stats);
+	searchContext.setCancelFlag(NULL);
+	{
+		lock_guard<mutex> lock(queueLock);
+		statistics.record(request->stats);
+	}
+	request->finish(status);
+}
+
+#endif
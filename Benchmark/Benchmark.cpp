@@ -0,0 +1,349 @@
+// Headless benchmark for PathFinder on MovingAI .map/.scen files.
+//
+// Builds without a window or Windows.h, only the SFML headers and
+// sfml-system/sfml-graphics are needed. On Linux:
+//
+//   g++ -O2 -std=c++17 -I.. Benchmark.cpp -o benchmark -lsfml-graphics -lsfml-window -lsfml-system -pthread
+//
+//   ./benchmark maze.map maze.map.scen --engine jps --json results.json
+//
+// The map can also be a binary .grid file made by ConvertMap, which is
+// mapped into memory instead of parsed.
+//
+// Every scenario is run once per repeat. The summary is printed and, with
+// --json, written as one JSON object so runs can be compared across
+// versions. --csv writes one row per query.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "PathFinder.hpp"
+#include "MovingAiMap.hpp"
+#include "GridFile.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+using namespace sf;
+
+// result of one query
+struct QueryRecord
+{
+	int scenario; // index of the scenario
+	double latencyUs;
+	int expanded; // cells expanded by the search
+	int generated; // cells reached by the search
+	int openPeak; // most cells in the open list at once
+	bool found;
+	double length; // length of the path found, in the scenario's units
+	double optimalLength;
+};
+
+/// <summary>
+/// Get the largest resident set size of this process so far
+/// </summary>
+/// <returns>the peak memory use in kilobytes, or -1 if unknown</returns>
+long getPeakMemoryKb()
+{
+#if defined(__unix__) || defined(__APPLE__)
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+	return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return -1;
+#endif
+}
+
+/// <summary>
+/// Get a percentile of some sorted values by the nearest rank
+/// </summary>
+/// <param name="sorted">the values in increasing order</param>
+/// <param name="percent">the percentile, from 0 to 100</param>
+/// <returns>the value at the percentile, or 0 if there are no values</returns>
+double percentile(const vector<double> &sorted, double percent)
+{
+	if (sorted.empty())
+	{
+		return 0;
+	}
+	int rank = (int)ceil(percent / 100 * sorted.size());
+	return sorted[max(0, min(rank - 1, (int)sorted.size() - 1))];
+}
+
+/// <summary>
+/// Print the command line options
+/// </summary>
+void printUsage()
+{
+	cerr << "usage: benchmark <file.map or file.grid> <file.scen> [options]" << endl
+		<< "  --engine astar|jps|bidirectional|weighted|anyangle" << endl
+		<< "                                    search to run (default astar), anyangle" << endl
+		<< "                                    ignores --no-diagonals" << endl
+		<< "  --heuristic octile|manhattan|chebyshev|zero" << endl
+		<< "                                    estimate of the astar engine (default octile)" << endl
+		<< "  --no-diagonals                    only move in 4 directions" << endl
+		<< "  --repeat <n>                      run every scenario n times (default 1)" << endl
+		<< "  --json <file>                     write the summary as JSON" << endl
+		<< "  --csv <file>                      write one row per query" << endl;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 3)
+	{
+		printUsage();
+		return 1;
+	}
+
+	string mapFile = argv[1];
+	string scenarioFile = argv[2];
+	string engine = "astar";
+	string heuristic = "octile";
+	bool includeDiagonals = true;
+	int repeat = 1;
+	string jsonFile;
+	string csvFile;
+	for (int i = 3; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--engine" && i + 1 < argc)
+		{
+			engine = argv[++i];
+		}
+		else if (arg == "--heuristic" && i + 1 < argc)
+		{
+			heuristic = argv[++i];
+		}
+		else if (arg == "--no-diagonals")
+		{
+			includeDiagonals = false;
+		}
+		else if (arg == "--repeat" && i + 1 < argc)
+		{
+			repeat = max(1, atoi(argv[++i]));
+		}
+		else if (arg == "--json" && i + 1 < argc)
+		{
+			jsonFile = argv[++i];
+		}
+		else if (arg == "--csv" && i + 1 < argc)
+		{
+			csvFile = argv[++i];
+		}
+		else
+		{
+			printUsage();
+			return 1;
+		}
+	}
+	if (engine != "astar" && engine != "jps" && engine != "bidirectional" && engine != "weighted"
+		&& engine != "anyangle")
+	{
+		cerr << "unknown engine " << engine << endl;
+		return 1;
+	}
+	if (heuristic != "octile" && heuristic != "manhattan" && heuristic != "chebyshev" && heuristic != "zero")
+	{
+		cerr << "unknown heuristic " << heuristic << endl;
+		return 1;
+	}
+
+	// load the map and scenarios
+	auto loadStart = chrono::steady_clock::now();
+	// .grid files are mapped instead of parsed
+	bool isGridFile = mapFile.size() > 5 && mapFile.compare(mapFile.size() - 5, 5, ".grid") == 0;
+	MovingAiMap map;
+	GridFile gridFile;
+	if (isGridFile ? !gridFile.open(mapFile) : !map.load(mapFile))
+	{
+		cerr << "can't read map " << mapFile << endl;
+		return 1;
+	}
+	vector<MovingAiMap::Scenario> scenarios;
+	if (!MovingAiMap::loadScenarios(scenarioFile, &scenarios))
+	{
+		cerr << "can't read scenarios " << scenarioFile << endl;
+		return 1;
+	}
+	PathFinder* pathFinder = isGridFile ? new PathFinder(&gridFile, 1) : map.createPathFinder(1);
+	pathFinder->setSearchEngine(engine == "jps" ? PathFinder::SearchEngine::JUMP_POINT
+		: engine == "weighted" ? PathFinder::SearchEngine::WEIGHTED
+		: PathFinder::SearchEngine::A_STAR);
+	pathFinder->setHeuristic(heuristic == "manhattan" ? PathFinder::Heuristic::MANHATTAN
+		: heuristic == "chebyshev" ? PathFinder::Heuristic::CHEBYSHEV
+		: heuristic == "zero" ? PathFinder::Heuristic::ZERO
+		: PathFinder::Heuristic::OCTILE);
+	double loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count();
+
+	// run every scenario
+	SearchContext context;
+	SearchContext reverseContext;
+	vector<Vector2i> path;
+	vector<QueryRecord> records;
+	records.reserve(scenarios.size() * repeat);
+	for (int r = 0; r < repeat; r++)
+	{
+		for (int i = 0; i < scenarios.size(); i++)
+		{
+			const MovingAiMap::Scenario& scenario = scenarios[i];
+			QueryRecord record;
+			record.scenario = i;
+			record.optimalLength = scenario.optimalLength;
+
+			auto queryStart = chrono::steady_clock::now();
+			PathFinder::PathStatus status;
+			if (engine == "bidirectional")
+			{
+				PathFinder::BidirectionalStats stats;
+				// queries turned down before searching leave the counts alone
+				context.resetCounts();
+				reverseContext.resetCounts();
+				status = pathFinder->findBidirectionalPath(scenario.start, scenario.end, includeDiagonals,
+					&context, &reverseContext, &path, &stats);
+				record.expanded = stats.forwardExpanded + stats.backwardExpanded;
+				record.generated = context.getGeneratedCount() + reverseContext.getGeneratedCount();
+				record.openPeak = context.getOpenPeak() + reverseContext.getOpenPeak();
+			}
+			else if (engine == "anyangle")
+			{
+				PathFinder::AnyAngleStats stats;
+				context.resetCounts();
+				status = pathFinder->findAnyAnglePath(scenario.start, scenario.end, &context, &path, &stats);
+				record.expanded = stats.expanded;
+				record.generated = context.getGeneratedCount();
+				record.openPeak = context.getOpenPeak();
+			}
+			else
+			{
+				QueryStats stats;
+				status = pathFinder->findPath(scenario.start, scenario.end, includeDiagonals, 0, &context, &path, &stats);
+				record.expanded = stats.expanded;
+				record.generated = stats.generated;
+				record.openPeak = stats.openPeak;
+			}
+			record.latencyUs = chrono::duration<double, micro>(chrono::steady_clock::now() - queryStart).count();
+
+			// measure the path the way the scenarios do, with real diagonal
+			// lengths, which also measures the straight lines between waypoints
+			record.found = status == PathFinder::PathStatus::FOUND;
+			record.length = 0;
+			Vector2i prevPos = scenario.start;
+			for (int j = 0; j < path.size() && record.found; j++)
+			{
+				record.length += hypot((double)(path[j].x - prevPos.x), (double)(path[j].y - prevPos.y));
+				prevPos = path[j];
+			}
+			records.push_back(record);
+		}
+	}
+	long peakMemoryKb = getPeakMemoryKb();
+
+	// summarize
+	vector<double> latencies;
+	double totalLatency = 0;
+	long long totalExpanded = 0;
+	long long totalGenerated = 0;
+	int maxOpenPeak = 0;
+	int found = 0;
+	int compared = 0;
+	double totalAbsError = 0;
+	double maxAbsError = 0;
+	double totalRelError = 0;
+	for (int i = 0; i < records.size(); i++)
+	{
+		const QueryRecord& record = records[i];
+		latencies.push_back(record.latencyUs);
+		totalLatency += record.latencyUs;
+		totalExpanded += record.expanded;
+		totalGenerated += record.generated;
+		maxOpenPeak = max(maxOpenPeak, record.openPeak);
+		if (!record.found)
+		{
+			continue;
+		}
+		found++;
+		// the scenarios' optimal lengths forbid cutting corners, which
+		// PathFinder allows, so the error can be negative with diagonals
+		double error = record.length - record.optimalLength;
+		totalAbsError += fabs(error);
+		maxAbsError = max(maxAbsError, fabs(error));
+		if (record.optimalLength > 0)
+		{
+			totalRelError += error / record.optimalLength;
+			compared++;
+		}
+	}
+	sort(latencies.begin(), latencies.end());
+	int numQueries = (int)records.size();
+	double meanLatency = numQueries > 0 ? totalLatency / numQueries : 0;
+	double meanExpanded = numQueries > 0 ? (double)totalExpanded / numQueries : 0;
+	double meanGenerated = numQueries > 0 ? (double)totalGenerated / numQueries : 0;
+	double meanAbsError = found > 0 ? totalAbsError / found : 0;
+	double meanRelError = compared > 0 ? totalRelError / compared : 0;
+
+	cout << mapFile << " " << engine << (includeDiagonals ? " 8-way" : " 4-way") << endl
+		<< "  queries " << numQueries << ", found " << found << endl
+		<< "  latency us: mean " << meanLatency << " p50 " << percentile(latencies, 50)
+		<< " p90 " << percentile(latencies, 90) << " p99 " << percentile(latencies, 99)
+		<< " max " << percentile(latencies, 100) << endl
+		<< "  expanded: mean " << meanExpanded << " total " << totalExpanded << endl
+		<< "  generated: mean " << meanGenerated << " total " << totalGenerated
+		<< ", open list peak " << maxOpenPeak << endl
+		<< "  length error: mean abs " << meanAbsError << " max abs " << maxAbsError
+		<< " mean rel " << meanRelError << endl
+		<< "  load ms " << loadMs << ", peak memory kb " << peakMemoryKb << endl;
+
+	if (!jsonFile.empty())
+	{
+		ofstream json(jsonFile);
+		json << "{" << endl
+			<< "  \"map\": \"" << mapFile << "\"," << endl
+			<< "  \"scenarios\": \"" << scenarioFile << "\"," << endl
+			<< "  \"engine\": \"" << engine << "\"," << endl
+			<< "  \"heuristic\": \"" << heuristic << "\"," << endl
+			<< "  \"diagonals\": " << (includeDiagonals ? "true" : "false") << "," << endl
+			<< "  \"width\": " << pathFinder->getGrid()->getGridWidth() << "," << endl
+			<< "  \"height\": " << pathFinder->getGrid()->getGridHeight() << "," << endl
+			<< "  \"queries\": " << numQueries << "," << endl
+			<< "  \"found\": " << found << "," << endl
+			<< "  \"load_ms\": " << loadMs << "," << endl
+			<< "  \"latency_us\": { \"mean\": " << meanLatency
+			<< ", \"p50\": " << percentile(latencies, 50)
+			<< ", \"p90\": " << percentile(latencies, 90)
+			<< ", \"p99\": " << percentile(latencies, 99)
+			<< ", \"max\": " << percentile(latencies, 100) << " }," << endl
+			<< "  \"expanded\": { \"mean\": " << meanExpanded << ", \"total\": " << totalExpanded << " }," << endl
+			<< "  \"generated\": { \"mean\": " << meanGenerated << ", \"total\": " << totalGenerated << " }," << endl
+			<< "  \"open_peak\": " << maxOpenPeak << "," << endl
+			<< "  \"length_error\": { \"mean_abs\": " << meanAbsError << ", \"max_abs\": " << maxAbsError
+			<< ", \"mean_rel\": " << meanRelError << " }," << endl
+			<< "  \"peak_memory_kb\": " << peakMemoryKb << endl
+			<< "}" << endl;
+	}
+
+	if (!csvFile.empty())
+	{
+		ofstream csv(csvFile);
+		csv << "scenario,latency_us,expanded,generated,open_peak,found,length,optimal_length" << endl;
+		for (int i = 0; i < records.size(); i++)
+		{
+			const QueryRecord& record = records[i];
+			csv << record.scenario << "," << record.latencyUs << "," << record.expanded << ","
+				<< record.generated << "," << record.openPeak << ","
+				<< (record.found ? 1 : 0) << "," << record.length << "," << record.optimalLength << endl;
+		}
+	}
+
+	delete(pathFinder);
+	return 0;
+}
@@ -0,0 +1,36 @@
+// Converts a MovingAI .map text file to the binary .grid format of
+// GridFile.hpp, which PathFinder can map into memory and search in place.
+//
+//   g++ -O2 -std=c++17 -I.. ConvertMap.cpp -o convertmap -lsfml-graphics -lsfml-window -lsfml-system -pthread
+//
+//   ./convertmap maze.map maze.grid
+
+#include <iostream>
+#include <string>
+#include "MovingAiMap.hpp"
+
+using namespace std;
+
+int main(int argc, char **argv)
+{
+	if (argc != 3)
+	{
+		cerr << "usage: convertmap <file.map> <file.grid>" << endl;
+		return 1;
+	}
+
+	MovingAiMap map;
+	if (!map.load(argv[1]))
+	{
+		cerr << "can't read map " << argv[1] << endl;
+		return 1;
+	}
+	if (!map.saveGridFile(argv[2]))
+	{
+		cerr << "can't write " << argv[2] << endl;
+		return 1;
+	}
+
+	cout << "wrote " << map.getWidth() << "x" << map.getHeight() << " grid to " << argv[2] << endl;
+	return 0;
+}
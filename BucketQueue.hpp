@@ -0,0 +1,113 @@
+#ifndef BUCKET_QUEUE_H
+#define BUCKET_QUEUE_H
+
+#include <vector>
+
+using namespace std;
+
+/// <summary>
+/// A priority queue of ids with small integer keys, kept in one bucket per
+/// key (Dial's algorithm). It works for searches whose keys never go below
+/// the last key popped and never go more than a fixed spread above it, as
+/// with A* over bounded integer move costs and a consistent estimate. The
+/// buckets are reused in a circle, so push and pop take O(1) time apart
+/// from skipping the empty buckets between keys.
+///
+/// Keys can't be lowered in place. Pushing an id again with a lower key
+/// leaves the old entry behind, so the caller has to skip entries whose
+/// key no longer matches the id's key when they are popped.
+/// </summary>
+class BucketQueue
+{
+private:
+	vector<vector<int>> buckets; // ids of each key, the key modulo the number of buckets
+	int numBuckets; // the spread of keys that can be queued at once
+	int lowestKey; // no queued id has a smaller key
+	int count; // number of queued ids, stale entries included
+
+public:
+	BucketQueue();
+
+	void reset(int keySpread, int firstKey);
+
+	bool isEmpty();
+
+	void push(int id, int key);
+
+	int pop(int *key);
+};
+
+/// <summary>
+/// Create an empty queue. reset has to be called before the first push.
+/// </summary>
+BucketQueue::BucketQueue()
+{
+	numBuckets = 0;
+	lowestKey = 0;
+	count = 0;
+}
+
+/// <summary>
+/// Empty the queue and get it ready for a new search. The buckets are kept,
+/// so a queue reused across searches doesn't allocate once it has grown.
+/// </summary>
+/// <param name="keySpread">one more than the most a pushed key can be above
+/// the last key popped</param>
+/// <param name="firstKey">the smallest key that will be pushed</param>
+void BucketQueue::reset(int keySpread, int firstKey)
+{
+	for (int i = 0; i < buckets.size(); i++)
+	{
+		buckets[i].clear();
+	}
+	if ((int)buckets.size() < keySpread)
+	{
+		buckets.resize(keySpread);
+	}
+	numBuckets = keySpread;
+	lowestKey = firstKey;
+	count = 0;
+}
+
+/// <summary>
+/// Check if the queue is empty
+/// </summary>
+/// <returns>true if no ids are queued and false otherwise</returns>
+bool BucketQueue::isEmpty()
+{
+	return count == 0;
+}
+
+/// <summary>
+/// Queue an id
+/// </summary>
+/// <param name="id">the id to queue</param>
+/// <param name="key">the key of the id, less than the spread above the last key popped</param>
+void BucketQueue::push(int id, int key)
+{
+	buckets[key % numBuckets].push_back(id);
+	count++;
+}
+
+/// <summary>
+/// Take out one of the ids with the smallest key. Ids with the same key
+/// come out newest first.
+/// </summary>
+/// <param name="key">set to the key the id was pushed with</param>
+/// <returns>the id taken out</returns>
+int BucketQueue::pop(int *key)
+{
+	while (buckets[lowestKey % numBuckets].empty())
+	{
+		lowestKey++;
+	}
+
+	vector<int>& bucket = buckets[lowestKey % numBuckets];
+	int id = bucket.back();
+	bucket.pop_back();
+	count--;
+	*key = lowestKey;
+	return id;
+}
+
+#endif
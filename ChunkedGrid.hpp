@@ -0,0 +1,623 @@
+#ifndef CHUNKED_GRID_H
+#define CHUNKED_GRID_H
+
+#include <SFML/Graphics.hpp>
+#include "Neighbours.hpp"
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <cstdio>
+
+using namespace std;
+using namespace sf;
+
+// width and height of a chunk in cells
+const int GRID_CHUNK_SIZE = 64;
+const int GRID_CHUNK_CELLS = GRID_CHUNK_SIZE * GRID_CHUNK_SIZE;
+
+/// <summary>
+/// A grid made of square chunks of cells, for worlds too big to allocate
+/// in one piece that are mostly empty. A chunk whose cells all hold the
+/// same value is stored as that one value, and chunks that only hold the
+/// default value aren't stored at all, so an empty world of any size costs
+/// nothing.
+///
+/// At most a fixed number of chunks have their cells in memory. Touching
+/// another chunk pages the least recently used one out to a page file and
+/// reads the touched one back in, collapsing chunks that became uniform
+/// instead of writing them. T has to be copyable as raw bytes and
+/// comparable with ==.
+///
+/// Cells are read by value rather than through pointers, since any read
+/// can page out the chunk a pointer would point into. Ids are long long,
+/// so worlds can have more cells than an int can count.
+/// </summary>
+template <typename T>
+class ChunkedGrid
+{
+private:
+	// a chunk with cells that aren't all the default value
+	struct Chunk
+	{
+		T uniformValue; // value of every cell while the chunk has no cells of its own
+		T *cells; // the cells row by row while resident, NULL otherwise
+		bool pagedOut; // the cells are in the page file rather than in memory
+		bool dirty; // the cells changed since they were last written out
+		long long pageSlot; // slot of the chunk in the page file, -1 if it has none
+		list<long long>::iterator residentPos; // place in the resident order while resident
+	};
+
+	int gridWidth;
+	int gridHeight;
+	int chunksWide;
+	T defaultValue; // value of every cell of the chunks that aren't stored
+	unordered_map<long long, Chunk*> chunks; // the stored chunks by chunk key
+	list<long long> residentOrder; // keys of the resident chunks, most recently used first
+	int maxResidentChunks;
+	string pageFileName;
+	fstream pageFile; // closed if chunks can't be paged out
+	long long pageSlotCount; // slots handed out in the page file
+	vector<long long> freePageSlots; // slots of chunks that collapsed or were dropped
+	unsigned long long revision; // number of cells whose value changed
+	long long lastKey; // key of the chunk found by the last lookup, -1 if none
+	Chunk *lastChunk; // chunk found by the last lookup, NULL if it isn't stored
+
+public:
+	ChunkedGrid(int width, int height, const T &defaultValue, int maxResidentChunks,
+		const string &pageFileName);
+
+	~ChunkedGrid();
+
+	bool isPaging();
+
+	T getValueAt(int x, int y);
+
+	bool setValAt(int x, int y, const T &val);
+
+	bool setValAt(Vector2i pos, const T &val);
+
+	void readRegion(int left, int top, int width, int height, T *out);
+
+	long long toIndex(int x, int y);
+
+	Vector2i toCoords(long long index);
+
+	int getGridWidth();
+
+	int getGridHeight();
+
+	bool validCoords(int x, int y);
+
+	int getNeighbourIds(int x, int y, bool includeDiagonals, long long *ids);
+
+	int getStoredChunkCount();
+
+	int getResidentChunkCount();
+
+	unsigned long long getRevision();
+
+private:
+	long long chunkKey(int x, int y);
+
+	Chunk *findChunk(long long key);
+
+	T *getCells(long long key, Chunk *chunk);
+
+	void makeResident(long long key, Chunk *chunk);
+
+	bool pageIn(Chunk *chunk);
+
+	void evictChunks();
+
+	bool pageOut(Chunk *chunk);
+
+	void dropChunk(long long key, Chunk *chunk);
+
+	ChunkedGrid(const ChunkedGrid &other) = delete;
+
+	ChunkedGrid &operator = (const ChunkedGrid &other) = delete;
+};
+
+/// <summary>
+/// Create a grid with every cell holding the default value
+/// </summary>
+/// <param name="width">the width of the grid</param>
+/// <param name="height">the height of the grid</param>
+/// <param name="defaultValue">the value of every cell to begin with</param>
+/// <param name="maxResidentChunks">the most chunks whose cells are kept in memory at once</param>
+/// <param name="pageFileName">the file chunks are paged out to, created or
+/// emptied now and deleted with the grid. If it is empty or can't be
+/// created, every chunk stays in memory.</param>
+template <typename T>
+ChunkedGrid<T>::ChunkedGrid(int width, int height, const T &defaultValue, int maxResidentChunks,
+	const string &pageFileName)
+{
+	gridWidth = width;
+	gridHeight = height;
+	chunksWide = (width + GRID_CHUNK_SIZE - 1) / GRID_CHUNK_SIZE;
+	this->defaultValue = defaultValue;
+	this->maxResidentChunks = max(1, maxResidentChunks);
+	this->pageFileName = pageFileName;
+	pageSlotCount = 0;
+	revision = 0;
+	lastKey = -1;
+	lastChunk = NULL;
+	if (!pageFileName.empty())
+	{
+		pageFile.open(pageFileName, ios::in | ios::out | ios::binary | ios::trunc);
+	}
+}
+
+/// <summary>
+/// Free every chunk and delete the page file
+/// </summary>
+template <typename T>
+ChunkedGrid<T>::~ChunkedGrid()
+{
+	for (auto it = chunks.begin(); it != chunks.end(); it++)
+	{
+		delete[](it->second->cells);
+		delete(it->second);
+	}
+	if (pageFile.is_open())
+	{
+		pageFile.close();
+		remove(pageFileName.c_str());
+	}
+}
+
+/// <summary>
+/// Check if chunks can be paged out
+/// </summary>
+/// <returns>true if the page file is open and false if every chunk stays in memory</returns>
+template <typename T>
+bool ChunkedGrid<T>::isPaging()
+{
+	return pageFile.is_open();
+}
+
+/// <summary>
+/// Get the value of a cell, paging its chunk in if needed
+/// </summary>
+/// <param name="x">the x coordinate of a cell in the grid</param>
+/// <param name="y">the y coordinate of a cell in the grid</param>
+/// <returns>the value of the cell</returns>
+template <typename T>
+T ChunkedGrid<T>::getValueAt(int x, int y)
+{
+	long long key = chunkKey(x, y);
+	Chunk* chunk = findChunk(key);
+	if (chunk == NULL)
+	{
+		return defaultValue;
+	}
+	if (chunk->cells == NULL && !chunk->pagedOut)
+	{
+		return chunk->uniformValue;
+	}
+	T* cells = getCells(key, chunk);
+	return cells[(y % GRID_CHUNK_SIZE) * GRID_CHUNK_SIZE + x % GRID_CHUNK_SIZE];
+}
+
+/// <summary>
+/// Set the value of a cell, giving its chunk cells of its own if it was uniform
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+/// <param name="val">the new value</param>
+/// <returns>true if the coordinates are in the grid and false otherwise</returns>
+template <typename T>
+bool ChunkedGrid<T>::setValAt(int x, int y, const T &val)
+{
+	if (!validCoords(x, y))
+	{
+		return false;
+	}
+
+	long long key = chunkKey(x, y);
+	Chunk* chunk = findChunk(key);
+	if (chunk == NULL)
+	{
+		if (val == defaultValue)
+		{
+			return true;
+		}
+		chunk = new Chunk();
+		chunk->uniformValue = defaultValue;
+		chunk->cells = NULL;
+		chunk->pagedOut = false;
+		chunk->dirty = false;
+		chunk->pageSlot = -1;
+		chunks[key] = chunk;
+		lastKey = key;
+		lastChunk = chunk;
+	}
+	if (chunk->cells == NULL && !chunk->pagedOut)
+	{
+		if (val == chunk->uniformValue)
+		{
+			return true;
+		}
+		chunk->cells = new T[GRID_CHUNK_CELLS];
+		fill(chunk->cells, chunk->cells + GRID_CHUNK_CELLS, chunk->uniformValue);
+		makeResident(key, chunk);
+	}
+
+	T* cells = getCells(key, chunk);
+	T* cell = cells + (y % GRID_CHUNK_SIZE) * GRID_CHUNK_SIZE + x % GRID_CHUNK_SIZE;
+	if (!(*cell == val))
+	{
+		*cell = val;
+		chunk->dirty = true;
+		revision++;
+	}
+	return true;
+}
+
+/// <summary>
+/// Set the value of a cell
+/// </summary>
+/// <param name="pos">the grid position of the cell</param>
+/// <param name="val">the new value</param>
+/// <returns>true if the position is in the grid and false otherwise</returns>
+template <typename T>
+bool ChunkedGrid<T>::setValAt(Vector2i pos, const T &val)
+{
+	return setValAt(pos.x, pos.y, val);
+}
+
+/// <summary>
+/// Copy a rectangle of cells out a chunk at a time, which fills uniform
+/// chunks without looking them up per cell
+/// </summary>
+/// <param name="left">the x coordinate of the left column, in the grid</param>
+/// <param name="top">the y coordinate of the top row, in the grid</param>
+/// <param name="width">the number of columns, which must stay in the grid</param>
+/// <param name="height">the number of rows, which must stay in the grid</param>
+/// <param name="out">filled with the cells row by row, needs room for width * height</param>
+template <typename T>
+void ChunkedGrid<T>::readRegion(int left, int top, int width, int height, T *out)
+{
+	for (int chunkTop = top - top % GRID_CHUNK_SIZE; chunkTop < top + height; chunkTop += GRID_CHUNK_SIZE)
+	{
+		int rowBegin = max(top, chunkTop);
+		int rowEnd = min(top + height, chunkTop + GRID_CHUNK_SIZE);
+		for (int chunkLeft = left - left % GRID_CHUNK_SIZE; chunkLeft < left + width; chunkLeft += GRID_CHUNK_SIZE)
+		{
+			int columnBegin = max(left, chunkLeft);
+			int columnEnd = min(left + width, chunkLeft + GRID_CHUNK_SIZE);
+			long long key = chunkKey(chunkLeft, chunkTop);
+			Chunk* chunk = findChunk(key);
+			T* cells = NULL;
+			T uniformValue = defaultValue;
+			if (chunk != NULL && (chunk->cells != NULL || chunk->pagedOut))
+			{
+				cells = getCells(key, chunk);
+			}
+			else if (chunk != NULL)
+			{
+				uniformValue = chunk->uniformValue;
+			}
+
+			for (int y = rowBegin; y < rowEnd; y++)
+			{
+				T* outRow = out + (long long)(y - top) * width + (columnBegin - left);
+				if (cells == NULL)
+				{
+					fill(outRow, outRow + (columnEnd - columnBegin), uniformValue);
+				}
+				else
+				{
+					const T* chunkRow = cells + (y - chunkTop) * GRID_CHUNK_SIZE + (columnBegin - chunkLeft);
+					copy(chunkRow, chunkRow + (columnEnd - columnBegin), outRow);
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Get the id of a cell
+/// </summary>
+/// <param name="x">the x coordinate of a cell in the grid</param>
+/// <param name="y">the y coordinate of a cell in the grid</param>
+/// <returns>the index the cell would have in a row by row array of the grid</returns>
+template <typename T>
+long long ChunkedGrid<T>::toIndex(int x, int y)
+{
+	return (long long)y * gridWidth + x;
+}
+
+/// <summary>
+/// Get the coordinates of a cell id
+/// </summary>
+/// <param name="index">the id of a cell</param>
+/// <returns>the grid position of the cell</returns>
+template <typename T>
+Vector2i ChunkedGrid<T>::toCoords(long long index)
+{
+	return Vector2i((int)(index % gridWidth), (int)(index / gridWidth));
+}
+
+/// <summary>
+/// Get the grid's width
+/// </summary>
+/// <returns>the grid's width</returns>
+template <typename T>
+int ChunkedGrid<T>::getGridWidth()
+{
+	return gridWidth;
+}
+
+/// <summary>
+/// Get the grid's height
+/// </summary>
+/// <returns>the grid's height</returns>
+template <typename T>
+int ChunkedGrid<T>::getGridHeight()
+{
+	return gridHeight;
+}
+
+/// <summary>
+/// Check if coordinates are in the grid
+/// </summary>
+/// <param name="x">an x coordinate</param>
+/// <param name="y">a y coordinate</param>
+/// <returns>true if the coordinates are in the grid and false otherwise</returns>
+template <typename T>
+bool ChunkedGrid<T>::validCoords(int x, int y)
+{
+	return x >= 0 && x < gridWidth && y >= 0 && y < gridHeight;
+}
+
+/// <summary>
+/// Get the ids of the neighbouring cells around the given grid
+/// coordinates that are inside the grid, without allocating anything
+/// </summary>
+/// <param name="x">the x coordinate of a cell in the grid</param>
+/// <param name="y">the y coordinate of a cell in the grid</param>
+/// <param name="includeDiagonals">whether to include the diagonal neighbours</param>
+/// <param name="ids">filled with the ids of the neighbours, needs room for 8</param>
+/// <returns>the number of neighbours</returns>
+template <typename T>
+int ChunkedGrid<T>::getNeighbourIds(int x, int y, bool includeDiagonals, long long *ids)
+{
+	int count = 0;
+	int directions = neighbourDirections(includeDiagonals);
+	while (directions != 0)
+	{
+		int neighbour = popNeighbour(&directions);
+		int currX = x + NEIGHBOUR_X_OFFSETS[neighbour];
+		int currY = y + NEIGHBOUR_Y_OFFSETS[neighbour];
+		if (validCoords(currX, currY))
+		{
+			ids[count++] = toIndex(currX, currY);
+		}
+	}
+	return count;
+}
+
+/// <summary>
+/// Get the number of chunks that hold anything but the default value
+/// </summary>
+/// <returns>the number of stored chunks, resident, uniform or paged out</returns>
+template <typename T>
+int ChunkedGrid<T>::getStoredChunkCount()
+{
+	return (int)chunks.size();
+}
+
+/// <summary>
+/// Get the number of chunks whose cells are in memory
+/// </summary>
+/// <returns>the number of resident chunks</returns>
+template <typename T>
+int ChunkedGrid<T>::getResidentChunkCount()
+{
+	return (int)residentOrder.size();
+}
+
+/// <summary>
+/// Get the number of changes made to the grid, so copies of parts of it
+/// can tell when they are stale
+/// </summary>
+/// <returns>the number of cells whose value changed since the grid was made</returns>
+template <typename T>
+unsigned long long ChunkedGrid<T>::getRevision()
+{
+	return revision;
+}
+
+/// <summary>
+/// Get the key of the chunk a cell is in
+/// </summary>
+/// <param name="x">the x coordinate of a cell in the grid</param>
+/// <param name="y">the y coordinate of a cell in the grid</param>
+/// <returns>the chunk's index in a row by row array of the chunks</returns>
+template <typename T>
+long long ChunkedGrid<T>::chunkKey(int x, int y)
+{
+	return (long long)(y / GRID_CHUNK_SIZE) * chunksWide + x / GRID_CHUNK_SIZE;
+}
+
+/// <summary>
+/// Look up a chunk, remembering it since searches read the same chunk many
+/// times in a row
+/// </summary>
+/// <param name="key">the key of a chunk</param>
+/// <returns>the chunk, NULL if it only holds the default value</returns>
+template <typename T>
+typename ChunkedGrid<T>::Chunk *ChunkedGrid<T>::findChunk(long long key)
+{
+	if (key != lastKey)
+	{
+		auto it = chunks.find(key);
+		lastKey = key;
+		lastChunk = it == chunks.end() ? NULL : it->second;
+	}
+	return lastChunk;
+}
+
+/// <summary>
+/// Get the cells of a chunk that has cells of its own, paging it in if it
+/// is out and marking it as the most recently used
+/// </summary>
+/// <param name="key">the key of the chunk</param>
+/// <param name="chunk">the chunk</param>
+/// <returns>the chunk's cells, valid until another chunk is touched</returns>
+template <typename T>
+T *ChunkedGrid<T>::getCells(long long key, Chunk *chunk)
+{
+	if (chunk->pagedOut)
+	{
+		pageIn(chunk);
+		makeResident(key, chunk);
+	}
+	else if (residentOrder.front() != key)
+	{
+		residentOrder.splice(residentOrder.begin(), residentOrder, chunk->residentPos);
+	}
+	return chunk->cells;
+}
+
+/// <summary>
+/// Put a chunk that just got its cells at the front of the resident order,
+/// paging out the least recently used chunks past the cap
+/// </summary>
+/// <param name="key">the key of the chunk</param>
+/// <param name="chunk">the chunk</param>
+template <typename T>
+void ChunkedGrid<T>::makeResident(long long key, Chunk *chunk)
+{
+	residentOrder.push_front(key);
+	chunk->residentPos = residentOrder.begin();
+	evictChunks();
+}
+
+/// <summary>
+/// Read the cells of a paged out chunk back into memory
+/// </summary>
+/// <param name="chunk">the chunk</param>
+/// <returns>true if the cells were read and false if the page file failed,
+/// in which case the chunk is left uniform with the default value</returns>
+template <typename T>
+bool ChunkedGrid<T>::pageIn(Chunk *chunk)
+{
+	chunk->cells = new T[GRID_CHUNK_CELLS];
+	chunk->pagedOut = false;
+	chunk->dirty = false;
+	pageFile.seekg(chunk->pageSlot * (long long)(GRID_CHUNK_CELLS * sizeof(T)));
+	pageFile.read((char*)chunk->cells, GRID_CHUNK_CELLS * sizeof(T));
+	if (!pageFile)
+	{
+		pageFile.clear();
+		fill(chunk->cells, chunk->cells + GRID_CHUNK_CELLS, defaultValue);
+		return false;
+	}
+	return true;
+}
+
+/// <summary>
+/// Page out the least recently used chunks until no more than the cap
+/// are resident
+/// </summary>
+template <typename T>
+void ChunkedGrid<T>::evictChunks()
+{
+	// the most recently used chunk is never evicted, its cells are being used
+	while ((int)residentOrder.size() > maxResidentChunks && pageFile.is_open())
+	{
+		long long key = residentOrder.back();
+		Chunk* chunk = chunks[key];
+
+		// a chunk whose cells became all the same goes back to one value
+		T* cells = chunk->cells;
+		bool uniform = find_if(cells + 1, cells + GRID_CHUNK_CELLS,
+			[cells](const T &val) { return !(val == cells[0]); }) == cells + GRID_CHUNK_CELLS;
+		if (uniform)
+		{
+			residentOrder.pop_back();
+			chunk->uniformValue = cells[0];
+			delete[](chunk->cells);
+			chunk->cells = NULL;
+			if (chunk->pageSlot != -1)
+			{
+				freePageSlots.push_back(chunk->pageSlot);
+				chunk->pageSlot = -1;
+			}
+			if (chunk->uniformValue == defaultValue)
+			{
+				dropChunk(key, chunk);
+			}
+			continue;
+		}
+
+		if (!pageOut(chunk))
+		{
+			// keep everything in memory rather than lose cells
+			return;
+		}
+		residentOrder.pop_back();
+	}
+}
+
+/// <summary>
+/// Write the cells of a resident chunk to the page file, if they changed,
+/// and free them
+/// </summary>
+/// <param name="chunk">the chunk</param>
+/// <returns>true if the chunk was paged out and false if the page file failed</returns>
+template <typename T>
+bool ChunkedGrid<T>::pageOut(Chunk *chunk)
+{
+	if (chunk->dirty || chunk->pageSlot == -1)
+	{
+		if (chunk->pageSlot == -1)
+		{
+			if (freePageSlots.empty())
+			{
+				chunk->pageSlot = pageSlotCount++;
+			}
+			else
+			{
+				chunk->pageSlot = freePageSlots.back();
+				freePageSlots.pop_back();
+			}
+		}
+		pageFile.seekp(chunk->pageSlot * (long long)(GRID_CHUNK_CELLS * sizeof(T)));
+		pageFile.write((const char*)chunk->cells, GRID_CHUNK_CELLS * sizeof(T));
+		if (!pageFile)
+		{
+			pageFile.clear();
+			return false;
+		}
+	}
+	delete[](chunk->cells);
+	chunk->cells = NULL;
+	chunk->pagedOut = true;
+	chunk->dirty = false;
+	return true;
+}
+
+/// <summary>
+/// Forget a chunk that only holds the default value and has no cells
+/// </summary>
+/// <param name="key">the key of the chunk</param>
+/// <param name="chunk">the chunk</param>
+template <typename T>
+void ChunkedGrid<T>::dropChunk(long long key, Chunk *chunk)
+{
+	chunks.erase(key);
+	delete(chunk);
+	if (lastKey == key)
+	{
+		lastKey = -1;
+		lastChunk = NULL;
+	}
+}
+
+#endif
@@ -0,0 +1,301 @@
+#ifndef CHUNKED_PATH_FINDER_H
+#define CHUNKED_PATH_FINDER_H
+
+#include "PathFinder.hpp"
+#include "ChunkedGrid.hpp"
+#include "SearchContext.hpp"
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+using namespace sf;
+
+/// <summary>
+/// Finds paths in a ChunkedGrid world by copying the part of it around
+/// each query into a PathFinder of its own, so every engine searches the
+/// window as it would any grid. The window is the box around the start
+/// and end grown by a margin and rounded out to whole chunks. If no path
+/// is found inside it, the margin doubles until the window covers the
+/// world or reaches the size cap. The PathFinder is made once at the size
+/// cap and a smaller window fills its top left corner, with the rest of
+/// its cells occupied.
+///
+/// The window only grows while the start and end both belong to parts of
+/// it that touch its edges, since a part walled in by obstacles can't lead
+/// anywhere else. A path that has to leave the window to be shortest is
+/// missed, so paths are only guaranteed shortest once the window covers
+/// the whole world. A query whose endpoints are further apart than the cap
+/// has INVALID_ENDPOINTS.
+/// </summary>
+class ChunkedPathFinder
+{
+private:
+	ChunkedGrid<GridValue> *world;
+	PathFinder *window; // searches the window, NULL until the first query
+	int windowLeft; // position of the window in the world
+	int windowTop;
+	int windowWidth; // size of the window, 0 until the first query
+	int windowHeight;
+	unsigned long long windowRevision; // world revision the window was copied at
+	int maxWindowSize; // most cells the window can be wide or high
+	PathFinder::SearchEngine searchEngine;
+	SearchContext searchContext;
+	vector<GridValue> stripBuffer; // one row of chunks of the window
+
+public:
+	ChunkedPathFinder(ChunkedGrid<GridValue> *world, int maxWindowSize);
+
+	~ChunkedPathFinder();
+
+	void setSearchEngine(PathFinder::SearchEngine engine);
+
+	PathFinder::PathStatus findPath(Vector2i start, Vector2i end, bool includeDiagonals,
+		vector<Vector2i> *path);
+
+private:
+	void loadWindow(int left, int top, int width, int height);
+
+	bool canLeaveWindow(Vector2i pos, bool includeDiagonals);
+
+	ChunkedPathFinder(const ChunkedPathFinder &other) = delete;
+
+	ChunkedPathFinder &operator = (const ChunkedPathFinder &other) = delete;
+};
+
+/// <summary>
+/// Create a path finder for a chunked world
+/// </summary>
+/// <param name="world">the world to search, with OCCUPIED cells blocked and
+/// every other value passable</param>
+/// <param name="maxWindowSize">the most cells a window can be wide or high,
+/// rounded up to whole chunks</param>
+ChunkedPathFinder::ChunkedPathFinder(ChunkedGrid<GridValue> *world, int maxWindowSize)
+{
+	this->world = world;
+	this->maxWindowSize = max(1, (maxWindowSize + GRID_CHUNK_SIZE - 1) / GRID_CHUNK_SIZE) * GRID_CHUNK_SIZE;
+	window = NULL;
+	windowLeft = 0;
+	windowTop = 0;
+	windowWidth = 0;
+	windowHeight = 0;
+	windowRevision = 0;
+	searchEngine = PathFinder::SearchEngine::A_STAR;
+}
+
+/// <summary>
+/// Free the window
+/// </summary>
+ChunkedPathFinder::~ChunkedPathFinder()
+{
+	delete(window);
+}
+
+/// <summary>
+/// Set the algorithm used to search the windows
+/// </summary>
+/// <param name="engine">the engine to use</param>
+void ChunkedPathFinder::setSearchEngine(PathFinder::SearchEngine engine)
+{
+	searchEngine = engine;
+	if (window != NULL)
+	{
+		window->setSearchEngine(engine);
+	}
+}
+
+/// <summary>
+/// Find a path between two positions of the world
+/// </summary>
+/// <param name="start">the world position to start from</param>
+/// <param name="end">the world position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="path">filled with the world positions of the path starting
+/// after the start and ending with the end if a path is found</param>
+/// <returns>FOUND if a path was found. INVALID_ENDPOINTS if an endpoint is
+/// outside the world or the endpoints are too far apart to fit in a window
+/// of the size cap. UNREACHABLE if the end is occupied, if the start or end
+/// is walled in by obstacles, or if the biggest window tried had no path,
+/// which when that window was capped short of the world only means no path
+/// was found within the cap.</returns>
+PathFinder::PathStatus ChunkedPathFinder::findPath(Vector2i start, Vector2i end, bool includeDiagonals,
+	vector<Vector2i> *path)
+{
+	if (!world->validCoords(start.x, start.y) || !world->validCoords(end.x, end.y))
+	{
+		return PathFinder::PathStatus::INVALID_ENDPOINTS;
+	}
+	if (start != end && world->getValueAt(end.x, end.y) == GridValue::OCCUPIED)
+	{
+		return PathFinder::PathStatus::UNREACHABLE;
+	}
+
+	int worldWidth = world->getGridWidth();
+	int worldHeight = world->getGridHeight();
+	for (int margin = GRID_CHUNK_SIZE; ; margin *= 2)
+	{
+		// the box around the endpoints plus the margin, in whole chunks
+		int left = max(0, min(start.x, end.x) - margin) / GRID_CHUNK_SIZE * GRID_CHUNK_SIZE;
+		int top = max(0, min(start.y, end.y) - margin) / GRID_CHUNK_SIZE * GRID_CHUNK_SIZE;
+		int right = min(worldWidth, (max(start.x, end.x) + margin) / GRID_CHUNK_SIZE * GRID_CHUNK_SIZE + GRID_CHUNK_SIZE);
+		int bottom = min(worldHeight, (max(start.y, end.y) + margin) / GRID_CHUNK_SIZE * GRID_CHUNK_SIZE + GRID_CHUNK_SIZE);
+
+		// past the cap the window stays centred on the endpoints
+		bool capped = false;
+		if (right - left > maxWindowSize)
+		{
+			int centre = (start.x + end.x) / 2;
+			left = max(0, min(worldWidth - maxWindowSize, centre - maxWindowSize / 2));
+			right = left + maxWindowSize;
+			capped = true;
+		}
+		if (bottom - top > maxWindowSize)
+		{
+			int centre = (start.y + end.y) / 2;
+			top = max(0, min(worldHeight - maxWindowSize, centre - maxWindowSize / 2));
+			bottom = top + maxWindowSize;
+			capped = true;
+		}
+		if (start.x < left || start.x >= right || end.x < left || end.x >= right
+			|| start.y < top || start.y >= bottom || end.y < top || end.y >= bottom)
+		{
+			// the endpoints don't fit in one window
+			return PathFinder::PathStatus::INVALID_ENDPOINTS;
+		}
+
+		loadWindow(left, top, right - left, bottom - top);
+		Vector2i offset(windowLeft, windowTop);
+		PathFinder::PathStatus status = window->findPath(start - offset, end - offset, includeDiagonals,
+			&searchContext, path);
+		if (status == PathFinder::PathStatus::FOUND)
+		{
+			for (int i = 0; i < path->size(); i++)
+			{
+				(*path)[i] += offset;
+			}
+			return status;
+		}
+
+		bool coversWorld = left == 0 && top == 0 && right == worldWidth && bottom == worldHeight;
+		if (status != PathFinder::PathStatus::UNREACHABLE || coversWorld || capped
+			|| !canLeaveWindow(start - offset, includeDiagonals) || !canLeaveWindow(end - offset, includeDiagonals))
+		{
+			return status;
+		}
+	}
+}
+
+/// <summary>
+/// Copy a rectangle of the world into the top left corner of the window,
+/// a row of chunks at a time, and occupy the cells of the last rectangle
+/// that are outside of it. Nothing is copied if the window already holds
+/// the rectangle and the world hasn't changed since.
+/// </summary>
+/// <param name="left">the x coordinate of the left column, in the world</param>
+/// <param name="top">the y coordinate of the top row, in the world</param>
+/// <param name="width">the number of columns, at most the size cap</param>
+/// <param name="height">the number of rows, at most the size cap</param>
+void ChunkedPathFinder::loadWindow(int left, int top, int width, int height)
+{
+	if (window != NULL && windowWidth == width && windowHeight == height
+		&& windowLeft == left && windowTop == top && windowRevision == world->getRevision())
+	{
+		return;
+	}
+	if (window == NULL)
+	{
+		window = new PathFinder(min(maxWindowSize, world->getGridWidth()),
+			min(maxWindowSize, world->getGridHeight()), 1);
+		window->setSearchEngine(searchEngine);
+		// the new cells all start passable
+		windowWidth = window->getGrid()->getGridWidth();
+		windowHeight = window->getGrid()->getGridHeight();
+	}
+
+	int stride = window->getGrid()->getGridWidth();
+	OccupancyGrid* occupancy = window->getOccupancy();
+	// wall off what the last rectangle covered beyond this one
+	for (int y = 0; y < windowHeight; y++)
+	{
+		for (int x = (y < height ? width : 0); x < windowWidth; x++)
+		{
+			occupancy->setOccupied(y * stride + x, true);
+		}
+	}
+	windowLeft = left;
+	windowTop = top;
+	windowWidth = width;
+	windowHeight = height;
+	windowRevision = world->getRevision();
+
+	stripBuffer.resize((size_t)width * GRID_CHUNK_SIZE);
+	for (int stripTop = 0; stripTop < height; stripTop += GRID_CHUNK_SIZE)
+	{
+		int stripHeight = min(GRID_CHUNK_SIZE, height - stripTop);
+		world->readRegion(left, top + stripTop, width, stripHeight, stripBuffer.data());
+		for (int y = 0; y < stripHeight; y++)
+		{
+			const GridValue* row = stripBuffer.data() + y * width;
+			int rowStart = (stripTop + y) * stride;
+			for (int x = 0; x < width; x++)
+			{
+				occupancy->setOccupied(rowStart + x, row[x] == GridValue::OCCUPIED);
+			}
+		}
+	}
+
+	// the bits were written without setValAt, so the components are
+	// relabelled in one go by the first query that needs them
+	window->invalidateComponents();
+}
+
+/// <summary>
+/// Check if a path from a cell of the window could go on outside of it,
+/// which is when its component has a cell on an edge of the window that
+/// isn't an edge of the world
+/// </summary>
+/// <param name="pos">a position in the window</param>
+/// <param name="includeDiagonals">whether paths can move diagonally</param>
+/// <returns>true if the cell's component reaches such an edge or the cell
+/// is occupied, and false otherwise</returns>
+bool ChunkedPathFinder::canLeaveWindow(Vector2i pos, bool includeDiagonals)
+{
+	ComponentMap* components = window->getComponentMap(includeDiagonals);
+	int stride = window->getGrid()->getGridWidth();
+	int width = windowWidth;
+	int height = windowHeight;
+	int component = components->getComponent(pos.y * stride + pos.x);
+	if (component == -1)
+	{
+		// an occupied start can step to any neighbour, so assume the worst
+		return true;
+	}
+
+	// the columns of the left and right edges and the rows of the top and bottom edges
+	if (windowLeft > 0 || windowLeft + width < world->getGridWidth())
+	{
+		for (int y = 0; y < height; y++)
+		{
+			if ((windowLeft > 0 && components->getComponent(y * stride) == component)
+				|| (windowLeft + width < world->getGridWidth()
+					&& components->getComponent(y * stride + width - 1) == component))
+			{
+				return true;
+			}
+		}
+	}
+	if (windowTop > 0 || windowTop + height < world->getGridHeight())
+	{
+		for (int x = 0; x < width; x++)
+		{
+			if ((windowTop > 0 && components->getComponent(x) == component)
+				|| (windowTop + height < world->getGridHeight()
+					&& components->getComponent((height - 1) * stride + x) == component))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+#endif
@@ -0,0 +1,252 @@
+#ifndef CLEARANCE_MAP_H
+#define CLEARANCE_MAP_H
+
+#include "OccupancyGrid.hpp"
+#include "Neighbours.hpp"
+#include "ThreadPool.hpp"
+#include <vector>
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+
+// clearances stop counting here, so the largest agent radius that can fit is one less
+const int MAX_CLEARANCE = 32;
+
+/// <summary>
+/// The clearance of every cell of an occupancy grid: the Chebyshev distance
+/// to the nearest occupied cell or to the outside of the grid. An agent
+/// that covers the square of cells within some radius of its cell fits on
+/// a cell exactly when the clearance is more than that radius, so searches
+/// for big agents test one byte per neighbour instead of a whole footprint.
+///
+/// The distance is built in two passes that each treat rows independently:
+/// the distance to the nearest occupied cell along the row, then the
+/// clearance from the row distances of the rows above and below, since a
+/// Chebyshev square is a run of rows. Clearances are capped at
+/// MAX_CLEARANCE, which bounds the cells an edit can change, so editing a
+/// cell only redoes the rows and columns around it.
+/// </summary>
+class ClearanceMap
+{
+private:
+	OccupancyGrid *occupancy;
+	int width;
+	int height;
+	vector<unsigned char> rowDistances; // distance to the nearest blocked cell along the row, by cell id
+	vector<unsigned char> clearances; // by cell id
+	vector<unsigned char> oldRowDistances; // row distances around the last edit before it
+
+public:
+	ClearanceMap(OccupancyGrid *occupancy, ThreadPool *pool);
+
+	void rebuild(ThreadPool *pool);
+
+	void update(int x, int y);
+
+	int getClearance(int x, int y);
+
+	bool fits(int id, int agentRadius);
+
+	int getFittingNeighbours(int x, int y, int neighbours, int agentRadius);
+
+private:
+	void computeRowDistances(int y);
+
+	int computeClearance(int x, int y);
+};
+
+/// <summary>
+/// Build the clearances of an occupancy grid
+/// </summary>
+/// <param name="occupancy">the grid, whose edits must be passed to update</param>
+/// <param name="pool">threads to build with, NULL to build on the calling thread</param>
+ClearanceMap::ClearanceMap(OccupancyGrid *occupancy, ThreadPool *pool)
+{
+	this->occupancy = occupancy;
+	width = occupancy->getWidth();
+	height = occupancy->getHeight();
+	rowDistances.resize(width * height);
+	clearances.resize(width * height);
+	rebuild(pool);
+}
+
+/// <summary>
+/// Compute every clearance from scratch, spreading the rows over the
+/// threads of a pool
+/// </summary>
+/// <param name="pool">threads to build with, NULL to build on the calling thread</param>
+void ClearanceMap::rebuild(ThreadPool *pool)
+{
+	if (pool == NULL)
+	{
+		for (int y = 0; y < height; y++)
+		{
+			computeRowDistances(y);
+		}
+		for (int id = 0; id < width * height; id++)
+		{
+			clearances[id] = (unsigned char)computeClearance(id % width, id / width);
+		}
+		return;
+	}
+
+	// every row distance has to be known before any clearance, since a
+	// clearance reads the rows around its own
+	const int ROWS_PER_TASK = 16;
+	pool->parallelFor(height, ROWS_PER_TASK, [this](int begin, int end, int)
+	{
+		for (int y = begin; y < end; y++)
+		{
+			computeRowDistances(y);
+		}
+	});
+	pool->parallelFor(height, ROWS_PER_TASK, [this](int begin, int end, int)
+	{
+		for (int y = begin; y < end; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				clearances[y * width + x] = (unsigned char)computeClearance(x, y);
+			}
+		}
+	});
+}
+
+/// <summary>
+/// Bring the clearances up to date after a cell changed between occupied
+/// and passable. Only the part of the row whose distances changed, and the
+/// cells less than MAX_CLEARANCE rows above and below it, are redone.
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+void ClearanceMap::update(int x, int y)
+{
+	int rowStart = y * width;
+	// row distances further from the edit than the cap can't change
+	int left = max(0, x - MAX_CLEARANCE);
+	int right = min(width - 1, x + MAX_CLEARANCE);
+	oldRowDistances.assign(rowDistances.begin() + rowStart + left, rowDistances.begin() + rowStart + right + 1);
+	computeRowDistances(y);
+
+	int firstChanged = INT_MAX;
+	int lastChanged = -1;
+	for (int i = left; i <= right; i++)
+	{
+		if (rowDistances[rowStart + i] != oldRowDistances[i - left])
+		{
+			firstChanged = min(firstChanged, i);
+			lastChanged = i;
+		}
+	}
+
+	// a clearance only reads the row distances of rows closer than itself
+	int top = max(0, y - MAX_CLEARANCE + 1);
+	int bottom = min(height - 1, y + MAX_CLEARANCE - 1);
+	for (int row = top; row <= bottom; row++)
+	{
+		for (int column = firstChanged; column <= lastChanged; column++)
+		{
+			clearances[row * width + column] = (unsigned char)computeClearance(column, row);
+		}
+	}
+}
+
+/// <summary>
+/// Get the clearance of a cell
+/// </summary>
+/// <param name="x">the x coordinate of a cell in the grid</param>
+/// <param name="y">the y coordinate of a cell in the grid</param>
+/// <returns>the Chebyshev distance to the nearest occupied cell or the
+/// outside of the grid, 0 for occupied cells, at most MAX_CLEARANCE</returns>
+int ClearanceMap::getClearance(int x, int y)
+{
+	return clearances[y * width + x];
+}
+
+/// <summary>
+/// Check if an agent fits on a cell
+/// </summary>
+/// <param name="id">the id of a cell</param>
+/// <param name="agentRadius">the number of cells the agent covers on every
+/// side of its own, 0 for an agent of one cell</param>
+/// <returns>true if every cell the agent covers is passable and false otherwise</returns>
+bool ClearanceMap::fits(int id, int agentRadius)
+{
+	return clearances[id] > agentRadius;
+}
+
+/// <summary>
+/// Narrow a mask of passable neighbours down to the neighbours an agent fits on
+/// </summary>
+/// <param name="x">the x coordinate of a cell</param>
+/// <param name="y">the y coordinate of a cell</param>
+/// <param name="neighbours">a mask of neighbours in the grid, in the bit
+/// order of OccupancyGrid::getPassableNeighbours</param>
+/// <param name="agentRadius">the number of cells the agent covers on every side of its own</param>
+/// <returns>the mask of neighbours the agent fits on</returns>
+int ClearanceMap::getFittingNeighbours(int x, int y, int neighbours, int agentRadius)
+{
+	int id = y * width + x;
+	int fitting = 0;
+	while (neighbours != 0)
+	{
+		int neighbour = popNeighbour(&neighbours);
+		if (clearances[id + NEIGHBOUR_Y_OFFSETS[neighbour] * width + NEIGHBOUR_X_OFFSETS[neighbour]] > agentRadius)
+		{
+			fitting |= 1 << neighbour;
+		}
+	}
+	return fitting;
+}
+
+/// <summary>
+/// Compute the distance from every cell of a row to the nearest occupied
+/// cell of the row, counting the outside of the grid as occupied
+/// </summary>
+/// <param name="y">the y coordinate of the row</param>
+void ClearanceMap::computeRowDistances(int y)
+{
+	int rowStart = y * width;
+	// sweep right then left, counting up from the last occupied cell seen
+	int distance = 0;
+	for (int x = 0; x < width; x++)
+	{
+		distance = occupancy->isOccupied(rowStart + x) ? 0 : min(distance + 1, MAX_CLEARANCE);
+		rowDistances[rowStart + x] = (unsigned char)distance;
+	}
+	distance = 0;
+	for (int x = width - 1; x >= 0; x--)
+	{
+		distance = rowDistances[rowStart + x] == 0 ? 0 : min(distance + 1, MAX_CLEARANCE);
+		rowDistances[rowStart + x] = (unsigned char)min((int)rowDistances[rowStart + x], distance);
+	}
+}
+
+/// <summary>
+/// Compute the clearance of a cell from the row distances of the rows
+/// around it, looking one row further out at a time until no row could
+/// bring an occupied cell any closer
+/// </summary>
+/// <param name="x">the x coordinate of a cell</param>
+/// <param name="y">the y coordinate of a cell</param>
+/// <returns>the clearance of the cell</returns>
+int ClearanceMap::computeClearance(int x, int y)
+{
+	// the rows past the top and bottom edges count as occupied
+	int clearance = min(min((int)rowDistances[y * width + x], MAX_CLEARANCE), min(y + 1, height - y));
+	for (int rowOffset = 1; rowOffset < clearance; rowOffset++)
+	{
+		if (y - rowOffset >= 0)
+		{
+			clearance = min(clearance, max(rowOffset, (int)rowDistances[(y - rowOffset) * width + x]));
+		}
+		if (y + rowOffset < height)
+		{
+			clearance = min(clearance, max(rowOffset, (int)rowDistances[(y + rowOffset) * width + x]));
+		}
+	}
+	return clearance;
+}
+
+#endif
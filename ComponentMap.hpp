@@ -0,0 +1,540 @@
+#ifndef COMPONENT_MAP_H
+#define COMPONENT_MAP_H
+
+#include "OccupancyGrid.hpp"
+#include "Neighbours.hpp"
+#include <vector>
+#include <climits>
+
+using namespace std;
+
+/// <summary>
+/// Labels the passable cells of an occupancy grid by connected component,
+/// for paths with or without diagonal moves, so a query between two cells
+/// that can't reach each other is answered with one comparison instead of
+/// a search that floods everything reachable from the start.
+///
+/// The labels are kept up to date one edit at a time. A cell that becomes
+/// passable joins the components around it, relabelling all but the
+/// biggest. A cell that becomes occupied can only split its component if
+/// the cells around it aren't connected around it, in which case a search
+/// is started from each side at once, taking turns, and stopped as soon as
+/// at most one side is left unexplored, so only the smaller parts are
+/// walked and relabelled. Reading labels never changes anything, so
+/// queries on several threads can share the map while the grid is still.
+/// </summary>
+class ComponentMap
+{
+private:
+	// a component is split into at most this many parts by one cell
+	static const int MAX_SIDES = 4;
+
+	OccupancyGrid *occupancy;
+	int width;
+	int height;
+	int directions; // neighbour bits a path can move to
+	int idOffsets[8]; // id offsets of the neighbours
+	vector<int> labels; // component of each cell, -1 for occupied cells
+	vector<int> componentSizes; // number of cells with each label, 0 for unused labels
+	vector<int> freeLabels; // unused labels below componentSizes.size()
+	int componentCount;
+
+	// scratch state of the searches started by an edit
+	vector<unsigned int> visits; // search generation times MAX_SIDES plus the side that visited each cell
+	unsigned int generation;
+	vector<int> sideCells[MAX_SIDES]; // cells visited by each side, in visiting order
+
+public:
+	ComponentMap(OccupancyGrid *occupancy, bool includeDiagonals);
+
+	void rebuild();
+
+	void update(int x, int y);
+
+	int getComponent(int id);
+
+	int getComponentCount();
+
+	bool mayConnect(int startId, int endId);
+
+private:
+	int newLabel();
+
+	void freeLabel(int label);
+
+	int flood(int firstId, int fromLabel, int toLabel);
+
+	int getNeighbours(int id);
+
+	int countSides(int x, int y, int *sideIds);
+
+	void splitSides(int label, const int *sideIds, int numSides);
+
+	// the label vectors are big, copies are never needed
+	ComponentMap(const ComponentMap &other) = delete;
+
+	ComponentMap &operator = (const ComponentMap &other) = delete;
+};
+
+/// <summary>
+/// Label every passable cell of an occupancy grid
+/// </summary>
+/// <param name="occupancy">the grid, whose edits must be passed to update</param>
+/// <param name="includeDiagonals">whether paths can move diagonally</param>
+ComponentMap::ComponentMap(OccupancyGrid *occupancy, bool includeDiagonals)
+{
+	this->occupancy = occupancy;
+	width = occupancy->getWidth();
+	height = occupancy->getHeight();
+	directions = neighbourDirections(includeDiagonals);
+	for (int i = 0; i < 8; i++)
+	{
+		idOffsets[i] = NEIGHBOUR_Y_OFFSETS[i] * width + NEIGHBOUR_X_OFFSETS[i];
+	}
+	generation = 0;
+	rebuild();
+}
+
+/// <summary>
+/// Label every cell from scratch
+/// </summary>
+void ComponentMap::rebuild()
+{
+	int cellCount = width * height;
+	labels.assign(cellCount, -1);
+	componentSizes.clear();
+	freeLabels.clear();
+	componentCount = 0;
+	visits.assign(cellCount, 0);
+	generation = 0;
+
+	for (int id = 0; id < cellCount; id++)
+	{
+		if (labels[id] == -1 && !occupancy->isOccupied(id))
+		{
+			int label = newLabel();
+			labels[id] = label;
+			componentSizes[label] = flood(id, -1, label) + 1;
+		}
+	}
+}
+
+/// <summary>
+/// Bring the labels up to date after a cell changed between occupied and
+/// passable
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+void ComponentMap::update(int x, int y)
+{
+	int id = y * width + x;
+	bool occupied = occupancy->isOccupied(id);
+	if (occupied == (labels[id] == -1))
+	{
+		return;
+	}
+
+	if (!occupied)
+	{
+		// join the cell to the biggest component around it and move the
+		// other components into it
+		int neighbours = getNeighbours(id);
+		int biggest = -1;
+		int mask = neighbours;
+		while (mask != 0)
+		{
+			int label = labels[id + idOffsets[popNeighbour(&mask)]];
+			if (biggest == -1 || componentSizes[label] > componentSizes[biggest])
+			{
+				biggest = label;
+			}
+		}
+		if (biggest == -1)
+		{
+			biggest = newLabel();
+		}
+		labels[id] = biggest;
+		componentSizes[biggest]++;
+
+		while (neighbours != 0)
+		{
+			int neighbourId = id + idOffsets[popNeighbour(&neighbours)];
+			int label = labels[neighbourId];
+			if (label != biggest)
+			{
+				labels[neighbourId] = biggest;
+				componentSizes[biggest] += flood(neighbourId, label, biggest) + 1;
+				freeLabel(label);
+			}
+		}
+		return;
+	}
+
+	int label = labels[id];
+	labels[id] = -1;
+	componentSizes[label]--;
+	if (componentSizes[label] == 0)
+	{
+		freeLabel(label);
+		return;
+	}
+
+	int sideIds[MAX_SIDES];
+	int numSides = countSides(x, y, sideIds);
+	if (numSides > 1)
+	{
+		splitSides(label, sideIds, numSides);
+	}
+}
+
+/// <summary>
+/// Get the component of a cell
+/// </summary>
+/// <param name="id">the id of a cell</param>
+/// <returns>the label of the cell's component, or -1 if the cell is occupied</returns>
+int ComponentMap::getComponent(int id)
+{
+	return labels[id];
+}
+
+/// <summary>
+/// Get the number of components of passable cells
+/// </summary>
+/// <returns>the number of components</returns>
+int ComponentMap::getComponentCount()
+{
+	return componentCount;
+}
+
+/// <summary>
+/// Check if a path could join two cells. A search that starts on an
+/// occupied cell can still step off it, so that case is left to the search.
+/// </summary>
+/// <param name="startId">the id of the start cell</param>
+/// <param name="endId">the id of the end cell</param>
+/// <returns>false if the end can't be reached from the start and true otherwise</returns>
+bool ComponentMap::mayConnect(int startId, int endId)
+{
+	int endLabel = labels[endId];
+	return endLabel != -1 && (labels[startId] == -1 || labels[startId] == endLabel);
+}
+
+/// <summary>
+/// Take an unused label
+/// </summary>
+/// <returns>the label, with a size of 0</returns>
+int ComponentMap::newLabel()
+{
+	componentCount++;
+	if (!freeLabels.empty())
+	{
+		int label = freeLabels.back();
+		freeLabels.pop_back();
+		return label;
+	}
+	componentSizes.push_back(0);
+	return (int)componentSizes.size() - 1;
+}
+
+/// <summary>
+/// Give back a label no cell has any more
+/// </summary>
+/// <param name="label">the label</param>
+void ComponentMap::freeLabel(int label)
+{
+	componentSizes[label] = 0;
+	freeLabels.push_back(label);
+	componentCount--;
+}
+
+/// <summary>
+/// Relabel the cells connected to a cell that have one label with another
+/// </summary>
+/// <param name="firstId">the id of a cell that already has the new label</param>
+/// <param name="fromLabel">the label of the cells to relabel</param>
+/// <param name="toLabel">the label to give them</param>
+/// <returns>the number of cells relabelled, not counting the first</returns>
+int ComponentMap::flood(int firstId, int fromLabel, int toLabel)
+{
+	vector<int>& queue = sideCells[0];
+	queue.clear();
+	queue.push_back(firstId);
+	for (int head = 0; head < queue.size(); head++)
+	{
+		int id = queue[head];
+		int neighbours = getNeighbours(id);
+		while (neighbours != 0)
+		{
+			int neighbourId = id + idOffsets[popNeighbour(&neighbours)];
+			if (labels[neighbourId] == fromLabel)
+			{
+				labels[neighbourId] = toLabel;
+				queue.push_back(neighbourId);
+			}
+		}
+	}
+	return (int)queue.size() - 1;
+}
+
+/// <summary>
+/// Get the neighbours a path can move to from a cell
+/// </summary>
+/// <param name="id">the id of a cell</param>
+/// <returns>the mask of passable neighbours in the grid</returns>
+int ComponentMap::getNeighbours(int id)
+{
+	return occupancy->getPassableNeighbours(id % width, id / width) & directions;
+}
+
+/// <summary>
+/// Group the neighbours of a newly occupied cell by whether they are still
+/// connected through the other cells around it. Neighbours in different
+/// groups might still be connected the long way round.
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+/// <param name="sideIds">filled with the id of one neighbour of every group</param>
+/// <returns>the number of groups</returns>
+int ComponentMap::countSides(int x, int y, int *sideIds)
+{
+	// the cells around the cell in order going round, as neighbour bits
+	static const int RING[8] = { 0, 1, 2, 4, 7, 6, 5, 3 };
+	int passable = occupancy->getPassableNeighbours(x, y);
+	int id = y * width + x;
+
+	// cells next to each other going round are always connected, and with
+	// diagonals so are the straight neighbours on either side of a corner,
+	// which are two apart going round
+	int groups[8];
+	for (int i = 0; i < 8; i++)
+	{
+		groups[i] = i;
+	}
+	int step = directions == EightConnected::DIRECTIONS ? 2 : 1;
+	for (int i = 0; i < 8; i++)
+	{
+		for (int distance = 1; distance <= step; distance++)
+		{
+			int j = (i + distance) % 8;
+			bool bothPassable = (passable & (1 << RING[i])) && (passable & (1 << RING[j]));
+			if (bothPassable && (distance == 1 || !NEIGHBOUR_IS_DIAGONAL[RING[i]]))
+			{
+				int a = i;
+				int b = j;
+				while (groups[a] != a)
+				{
+					a = groups[a];
+				}
+				while (groups[b] != b)
+				{
+					b = groups[b];
+				}
+				groups[a] = b;
+			}
+		}
+	}
+
+	// keep one neighbour a path can move to per group, corner cells that
+	// aren't neighbours only join the ones next to them
+	int numSides = 0;
+	int sideGroups[8];
+	for (int i = 0; i < 8; i++)
+	{
+		int bit = RING[i];
+		if (!(passable & directions & (1 << bit)))
+		{
+			continue;
+		}
+		int group = i;
+		while (groups[group] != group)
+		{
+			group = groups[group];
+		}
+		bool seen = false;
+		for (int side = 0; side < numSides; side++)
+		{
+			seen = seen || sideGroups[side] == group;
+		}
+		if (!seen)
+		{
+			sideGroups[numSides] = group;
+			sideIds[numSides] = id + idOffsets[bit];
+			numSides++;
+		}
+	}
+	return numSides;
+}
+
+/// <summary>
+/// Find out which of the sides of a newly occupied cell are still
+/// connected, searching from all of them at once, and give a new label to
+/// every side that turns out to be cut off from the rest
+/// </summary>
+/// <param name="label">the label of the component the cell was in</param>
+/// <param name="sideIds">the id of one cell on every side</param>
+/// <param name="numSides">the number of sides, from 2 to MAX_SIDES</param>
+void ComponentMap::splitSides(int label, const int *sideIds, int numSides)
+{
+	generation++;
+	// start over once the generations wrap around so old visits can't match
+	if (generation >= UINT_MAX / MAX_SIDES)
+	{
+		visits.assign(visits.size(), 0);
+		generation = 1;
+	}
+	unsigned int firstVisit = generation * MAX_SIDES;
+
+	// sides that meet belong to the same component
+	int joined[MAX_SIDES];
+	int heads[MAX_SIDES];
+	bool exhausted[MAX_SIDES];
+	for (int s = 0; s < numSides; s++)
+	{
+		joined[s] = s;
+		heads[s] = 0;
+		exhausted[s] = false;
+		sideCells[s].clear();
+		sideCells[s].push_back(sideIds[s]);
+		visits[sideIds[s]] = firstVisit + s;
+	}
+
+	while (true)
+	{
+		// stop once at most one component is still being explored
+		int openComponents = 0;
+		int seenComponents[MAX_SIDES];
+		for (int s = 0; s < numSides; s++)
+		{
+			int component = joined[s];
+			while (joined[component] != component)
+			{
+				component = joined[component];
+			}
+			bool seen = false;
+			for (int c = 0; c < openComponents; c++)
+			{
+				seen = seen || seenComponents[c] == component;
+			}
+			if (!exhausted[s] && !seen)
+			{
+				seenComponents[openComponents++] = component;
+			}
+		}
+		if (openComponents <= 1)
+		{
+			break;
+		}
+
+		// one cell from every side still being explored
+		for (int s = 0; s < numSides; s++)
+		{
+			if (exhausted[s])
+			{
+				continue;
+			}
+			if (heads[s] == sideCells[s].size())
+			{
+				exhausted[s] = true;
+				continue;
+			}
+
+			int id = sideCells[s][heads[s]++];
+			int neighbours = getNeighbours(id);
+			while (neighbours != 0)
+			{
+				int neighbourId = id + idOffsets[popNeighbour(&neighbours)];
+				if (visits[neighbourId] >= firstVisit)
+				{
+					// met another side, join the two
+					int a = visits[neighbourId] - firstVisit;
+					int b = s;
+					while (joined[a] != a)
+					{
+						a = joined[a];
+					}
+					while (joined[b] != b)
+					{
+						b = joined[b];
+					}
+					joined[a] = b;
+				}
+				else if (labels[neighbourId] == label)
+				{
+					visits[neighbourId] = firstVisit + s;
+					sideCells[s].push_back(neighbourId);
+				}
+			}
+		}
+	}
+
+	// every component whose sides were all explored is cut off from the
+	// rest, unless it is the only one and keeps the old label
+	int roots[MAX_SIDES];
+	bool open[MAX_SIDES];
+	for (int s = 0; s < numSides; s++)
+	{
+		roots[s] = s;
+		while (joined[roots[s]] != roots[s])
+		{
+			roots[s] = joined[roots[s]];
+		}
+		open[s] = false;
+	}
+	bool anyOpen = false;
+	for (int s = 0; s < numSides; s++)
+	{
+		if (!exhausted[s])
+		{
+			open[roots[s]] = true;
+			anyOpen = true;
+		}
+	}
+
+	int keptRoot = -1;
+	if (!anyOpen)
+	{
+		// every side was explored, the biggest component keeps the old label
+		int biggestSize = -1;
+		for (int s = 0; s < numSides; s++)
+		{
+			int size = 0;
+			for (int t = 0; t < numSides; t++)
+			{
+				if (roots[t] == roots[s])
+				{
+					size += (int)sideCells[t].size();
+				}
+			}
+			if (size > biggestSize)
+			{
+				biggestSize = size;
+				keptRoot = roots[s];
+			}
+		}
+	}
+
+	for (int s = 0; s < numSides; s++)
+	{
+		int root = roots[s];
+		if (root != s || open[root] || root == keptRoot)
+		{
+			continue;
+		}
+		int newComponent = newLabel();
+		for (int t = 0; t < numSides; t++)
+		{
+			if (roots[t] != root)
+			{
+				continue;
+			}
+			for (int i = 0; i < sideCells[t].size(); i++)
+			{
+				labels[sideCells[t][i]] = newComponent;
+			}
+			componentSizes[newComponent] += (int)sideCells[t].size();
+			componentSizes[label] -= (int)sideCells[t].size();
+		}
+	}
+}
+
+#endif
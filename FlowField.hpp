@@ -0,0 +1,467 @@
+#ifndef FLOW_FIELD_H
+#define FLOW_FIELD_H
+
+#include "PathFinder.hpp"
+#include "Grid.hpp"
+#include "OccupancyGrid.hpp"
+#include "Neighbours.hpp"
+#include "SearchPolicies.hpp"
+#include "ThreadPool.hpp"
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <climits>
+
+using namespace std;
+using namespace sf;
+
+/// <summary>
+/// The octile distance from every cell of a PathFinder's grid to the
+/// nearest of a set of goals, and the neighbour to step to from every cell
+/// to get closer. Any number of agents heading for the same goals can
+/// follow the field with one lookup per step instead of one search each.
+///
+/// The grid is split into square tiles. A tile is brought up to date with
+/// a Dijkstra search of its own cells, seeded from the distances of the
+/// cells around it, and the tiles next to any edge cell that changed are queued
+/// for another pass until nothing changes. Tiles are taken in four phases
+/// by the parity of their column and row, so the tiles of one phase never
+/// touch each other and a phase runs them all on a thread pool at once.
+/// </summary>
+class FlowField
+{
+private:
+	// state of each cell of the field
+	struct FlowCell
+	{
+		int distance; // cost of the cheapest path to a goal, INT_MAX if there is none
+		signed char direction; // neighbour bit of the next step, -1 on goals and unreachable cells
+	};
+
+	// width and height of the tiles in cells
+	static const int TILE_SIZE = 32;
+
+	PathFinder *pathFinder;
+	Grid<FlowCell> *cells;
+	int directions; // neighbour bits paths can move to
+	int idOffsets[8]; // id offsets of the neighbours
+	unsigned long long revision; // grid revision the field was computed at
+
+	int tilesWide;
+	int tilesHigh;
+	vector<unsigned char> tileDirty; // whether each tile needs another pass
+	vector<unsigned char> tileChanged; // neighbour bits of the tiles each tile changed the edge next to
+	vector<unsigned char> tileVisited; // whether each tile has had a pass yet
+	vector<int> phaseTiles; // tiles to pass in the current phase
+	// open list of each worker thread's tile searches, as (distance, id)
+	vector<vector<pair<int, int>>> workerHeaps;
+
+public:
+	FlowField(PathFinder *pathFinder);
+
+	~FlowField();
+
+	void compute(const Vector2i *goals, int numGoals, bool includeDiagonals, ThreadPool *pool);
+
+	int getDistance(int x, int y);
+
+	bool getNextStep(Vector2i pos, Vector2i *next);
+
+	unsigned long long getRevision();
+
+private:
+	int relaxTile(int tile, vector<pair<int, int>> *heap);
+
+	void computeDirections(int firstRow, int lastRow);
+
+	void markNeighbourTiles(int tile, int neighbours);
+
+	FlowField(const FlowField &other) = delete;
+
+	FlowField &operator = (const FlowField &other) = delete;
+};
+
+/// <summary>
+/// Create an empty field over a PathFinder's grid. compute has to be
+/// called before the field is read.
+/// </summary>
+/// <param name="pathFinder">the path finder whose grid the field covers</param>
+FlowField::FlowField(PathFinder *pathFinder)
+{
+	this->pathFinder = pathFinder;
+	Grid<PathFinder::GridNode>* grid = pathFinder->getGrid();
+	int width = grid->getGridWidth();
+	int height = grid->getGridHeight();
+	cells = new Grid<FlowCell>(width, height, grid->getCellSize());
+	for (int id = 0; id < width * height; id++)
+	{
+		cells->getValueAt(id)->distance = INT_MAX;
+		cells->getValueAt(id)->direction = -1;
+	}
+	directions = EightConnected::DIRECTIONS;
+	for (int i = 0; i < 8; i++)
+	{
+		idOffsets[i] = NEIGHBOUR_Y_OFFSETS[i] * width + NEIGHBOUR_X_OFFSETS[i];
+	}
+	revision = ULLONG_MAX;
+
+	tilesWide = (width + TILE_SIZE - 1) / TILE_SIZE;
+	tilesHigh = (height + TILE_SIZE - 1) / TILE_SIZE;
+	tileDirty.assign(tilesWide * tilesHigh, 0);
+	tileChanged.assign(tilesWide * tilesHigh, 0);
+	tileVisited.assign(tilesWide * tilesHigh, 0);
+}
+
+/// <summary>
+/// Free the field
+/// </summary>
+FlowField::~FlowField()
+{
+	delete(cells);
+}
+
+/// <summary>
+/// Compute the distance and next step of every cell for a set of goals.
+/// The grid must not change until this returns. The field isn't updated
+/// when the grid changes afterwards, compare getRevision with the grid's
+/// revision to know when to compute it again.
+/// </summary>
+/// <param name="goals">the grid positions to head for, occupied or invalid ones are skipped</param>
+/// <param name="numGoals">the number of goals</param>
+/// <param name="includeDiagonals">whether paths can move diagonally</param>
+/// <param name="pool">threads to compute with, NULL to compute on the calling thread</param>
+void FlowField::compute(const Vector2i *goals, int numGoals, bool includeDiagonals, ThreadPool *pool)
+{
+	int width = cells->getGridWidth();
+	int height = cells->getGridHeight();
+	directions = neighbourDirections(includeDiagonals);
+	revision = pathFinder->getRevision();
+
+	for (int id = 0; id < width * height; id++)
+	{
+		cells->getValueAt(id)->distance = INT_MAX;
+		cells->getValueAt(id)->direction = -1;
+	}
+	fill(tileDirty.begin(), tileDirty.end(), 0);
+	fill(tileVisited.begin(), tileVisited.end(), 0);
+	int dirtyCount = 0;
+	for (int i = 0; i < numGoals; i++)
+	{
+		if (!pathFinder->isWalkable(goals[i].x, goals[i].y))
+		{
+			continue;
+		}
+		cells->getValueAt(goals[i].x, goals[i].y)->distance = 0;
+		int tile = (goals[i].y / TILE_SIZE) * tilesWide + goals[i].x / TILE_SIZE;
+		dirtyCount += tileDirty[tile] == 0 ? 1 : 0;
+		tileDirty[tile] = 1;
+	}
+
+	int numWorkers = pool != NULL ? pool->getThreadCount() : 1;
+	if ((int)workerHeaps.size() < numWorkers)
+	{
+		workerHeaps.resize(numWorkers);
+	}
+
+	// keep cycling through the phases until a whole cycle changes nothing
+	for (int phase = 0; dirtyCount > 0; phase = (phase + 1) % 4)
+	{
+		phaseTiles.clear();
+		for (int tileY = phase / 2; tileY < tilesHigh; tileY += 2)
+		{
+			for (int tileX = phase % 2; tileX < tilesWide; tileX += 2)
+			{
+				int tile = tileY * tilesWide + tileX;
+				if (tileDirty[tile])
+				{
+					tileDirty[tile] = 0;
+					dirtyCount--;
+					phaseTiles.push_back(tile);
+				}
+			}
+		}
+
+		if (pool != NULL && phaseTiles.size() > 1)
+		{
+			pool->parallelFor((int)phaseTiles.size(), 1, [this](int begin, int end, int worker)
+			{
+				for (int i = begin; i < end; i++)
+				{
+					tileChanged[phaseTiles[i]] = (unsigned char)relaxTile(phaseTiles[i], &workerHeaps[worker]);
+				}
+			});
+		}
+		else
+		{
+			for (int i = 0; i < phaseTiles.size(); i++)
+			{
+				tileChanged[phaseTiles[i]] = (unsigned char)relaxTile(phaseTiles[i], &workerHeaps[0]);
+			}
+		}
+
+		for (int i = 0; i < phaseTiles.size(); i++)
+		{
+			markNeighbourTiles(phaseTiles[i], tileChanged[phaseTiles[i]]);
+		}
+		dirtyCount = (int)count(tileDirty.begin(), tileDirty.end(), 1);
+	}
+
+	// every row's steps only read distances, which are final now
+	const int ROWS_PER_TASK = 16;
+	if (pool != NULL)
+	{
+		pool->parallelFor(height, ROWS_PER_TASK, [this](int begin, int end, int)
+		{
+			computeDirections(begin, end);
+		});
+	}
+	else
+	{
+		computeDirections(0, height);
+	}
+}
+
+/// <summary>
+/// Get the distance from a cell to the nearest goal
+/// </summary>
+/// <param name="x">the x coordinate of a cell</param>
+/// <param name="y">the y coordinate of a cell</param>
+/// <returns>the cost of the cheapest path to a goal, or -1 if the
+/// coordinates are invalid or no goal can be reached</returns>
+int FlowField::getDistance(int x, int y)
+{
+	if (!cells->validCoords(x, y) || cells->getValueAt(x, y)->distance == INT_MAX)
+	{
+		return -1;
+	}
+	return cells->getValueAt(x, y)->distance;
+}
+
+/// <summary>
+/// Get the cell to move to from a cell to get closer to the nearest goal
+/// </summary>
+/// <param name="pos">the grid position of an agent</param>
+/// <param name="next">set to the grid position of the next step</param>
+/// <returns>true if there is a step to take, false on a goal, an
+/// unreachable cell or invalid coordinates</returns>
+bool FlowField::getNextStep(Vector2i pos, Vector2i *next)
+{
+	if (!cells->validCoords(pos.x, pos.y))
+	{
+		return false;
+	}
+	int direction = cells->getValueAt(pos.x, pos.y)->direction;
+	if (direction == -1)
+	{
+		return false;
+	}
+	*next = Vector2i(pos.x + NEIGHBOUR_X_OFFSETS[direction], pos.y + NEIGHBOUR_Y_OFFSETS[direction]);
+	return true;
+}
+
+/// <summary>
+/// Get the grid revision the field was computed at
+/// </summary>
+/// <returns>the revision, or ULLONG_MAX if the field hasn't been computed</returns>
+unsigned long long FlowField::getRevision()
+{
+	return revision;
+}
+
+/// <summary>
+/// Bring the distances of one tile up to date with the cells around it.
+/// Only reads the cells of the tile and the ring of cells around it, and
+/// only writes the cells of the tile.
+/// </summary>
+/// <param name="tile">the index of the tile</param>
+/// <param name="heap">the open list of the calling worker</param>
+/// <returns>the neighbour bits of the tiles next to the edge cells whose distance went down</returns>
+int FlowField::relaxTile(int tile, vector<pair<int, int>> *heap)
+{
+	int width = cells->getGridWidth();
+	int height = cells->getGridHeight();
+	int left = (tile % tilesWide) * TILE_SIZE;
+	int top = (tile / tilesWide) * TILE_SIZE;
+	int right = min(left + TILE_SIZE, width);
+	int bottom = min(top + TILE_SIZE, height);
+	OccupancyGrid* occupancy = pathFinder->getOccupancy();
+	FlowCell* data = cells->getData();
+	greater<pair<int, int>> closerFirst;
+	heap->clear();
+	int changedTiles = 0;
+
+	// the first pass starts from the goals, the only cells with a distance
+	// before their tile has been passed
+	if (!tileVisited[tile])
+	{
+		tileVisited[tile] = 1;
+		for (int y = top; y < bottom; y++)
+		{
+			for (int x = left; x < right; x++)
+			{
+				int id = y * width + x;
+				if (data[id].distance == 0)
+				{
+					heap->push_back(make_pair(0, id));
+				}
+			}
+		}
+	}
+
+	// pull distances in from the cells just outside the edges
+	for (int y = top; y < bottom; y++)
+	{
+		for (int x = left; x < right; x++)
+		{
+			if (x != left && x != right - 1 && y != top && y != bottom - 1)
+			{
+				continue;
+			}
+			int id = y * width + x;
+			if (occupancy->isOccupied(id))
+			{
+				continue;
+			}
+			int neighbours = occupancy->getPassableNeighbours(x, y) & directions;
+			while (neighbours != 0)
+			{
+				int neighbour = popNeighbour(&neighbours);
+				int neighbourX = x + NEIGHBOUR_X_OFFSETS[neighbour];
+				int neighbourY = y + NEIGHBOUR_Y_OFFSETS[neighbour];
+				int neighbourDistance = data[id + idOffsets[neighbour]].distance;
+				bool outside = neighbourX < left || neighbourX >= right || neighbourY < top || neighbourY >= bottom;
+				if (!outside || neighbourDistance == INT_MAX)
+				{
+					continue;
+				}
+				// moving from the neighbour to the cell is the opposite move
+				int distance = neighbourDistance + OctileCosts::moveCost(neighbour);
+				if (distance < data[id].distance)
+				{
+					data[id].distance = distance;
+					heap->push_back(make_pair(distance, id));
+				}
+			}
+		}
+	}
+	make_heap(heap->begin(), heap->end(), closerFirst);
+
+	// Dijkstra over the cells of the tile
+	while (!heap->empty())
+	{
+		pop_heap(heap->begin(), heap->end(), closerFirst);
+		pair<int, int> entry = heap->back();
+		heap->pop_back();
+		int id = entry.second;
+		// skip entries left behind by cells whose distance went down again
+		if (entry.first != data[id].distance)
+		{
+			continue;
+		}
+
+		int x = id % width;
+		int y = id / width;
+		// a cell on the edge can shorten the paths of the tiles it touches
+		int edgeX = x == left ? -1 : (x == right - 1 ? 1 : 0);
+		int edgeY = y == top ? -1 : (y == bottom - 1 ? 1 : 0);
+		if (edgeX != 0)
+		{
+			changedTiles |= 1 << neighbourIndex(edgeX, 0);
+		}
+		if (edgeY != 0)
+		{
+			changedTiles |= 1 << neighbourIndex(0, edgeY);
+		}
+		if (edgeX != 0 && edgeY != 0)
+		{
+			changedTiles |= 1 << neighbourIndex(edgeX, edgeY);
+		}
+
+		int neighbours = occupancy->getPassableNeighbours(x, y) & directions;
+		while (neighbours != 0)
+		{
+			int neighbour = popNeighbour(&neighbours);
+			int neighbourX = x + NEIGHBOUR_X_OFFSETS[neighbour];
+			int neighbourY = y + NEIGHBOUR_Y_OFFSETS[neighbour];
+			if (neighbourX < left || neighbourX >= right || neighbourY < top || neighbourY >= bottom)
+			{
+				continue;
+			}
+			int neighbourId = id + idOffsets[neighbour];
+			int distance = entry.first + OctileCosts::moveCost(neighbour);
+			if (distance < data[neighbourId].distance)
+			{
+				data[neighbourId].distance = distance;
+				heap->push_back(make_pair(distance, neighbourId));
+				push_heap(heap->begin(), heap->end(), closerFirst);
+			}
+		}
+	}
+	return changedTiles;
+}
+
+/// <summary>
+/// Point every reachable cell of some rows at the neighbour its cheapest
+/// path to a goal goes through
+/// </summary>
+/// <param name="firstRow">the first row to do</param>
+/// <param name="lastRow">one past the last row to do</param>
+void FlowField::computeDirections(int firstRow, int lastRow)
+{
+	int width = cells->getGridWidth();
+	OccupancyGrid* occupancy = pathFinder->getOccupancy();
+	FlowCell* data = cells->getData();
+	for (int y = firstRow; y < lastRow; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			int id = y * width + x;
+			data[id].direction = -1;
+			if (data[id].distance == 0 || data[id].distance == INT_MAX)
+			{
+				continue;
+			}
+
+			int bestDistance = INT_MAX;
+			int neighbours = occupancy->getPassableNeighbours(x, y) & directions;
+			while (neighbours != 0)
+			{
+				int neighbour = popNeighbour(&neighbours);
+				int neighbourDistance = data[id + idOffsets[neighbour]].distance;
+				if (neighbourDistance == INT_MAX)
+				{
+					continue;
+				}
+				int distance = neighbourDistance + OctileCosts::moveCost(neighbour);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					data[id].direction = (signed char)neighbour;
+				}
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Queue some of the tiles around a tile for another pass
+/// </summary>
+/// <param name="tile">the index of a tile that changed</param>
+/// <param name="neighbours">the neighbour bits of the tiles to queue</param>
+void FlowField::markNeighbourTiles(int tile, int neighbours)
+{
+	int tileX = tile % tilesWide;
+	int tileY = tile / tilesWide;
+	while (neighbours != 0)
+	{
+		int neighbour = popNeighbour(&neighbours);
+		int x = tileX + NEIGHBOUR_X_OFFSETS[neighbour];
+		int y = tileY + NEIGHBOUR_Y_OFFSETS[neighbour];
+		if (x >= 0 && x < tilesWide && y >= 0 && y < tilesHigh)
+		{
+			tileDirty[y * tilesWide + x] = 1;
+		}
+	}
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <SFML/Graphics.hpp>
 #include "GridCellStates.hpp"
+#include "Neighbours.hpp"
 #include "math.h"
 #include <stdio.h>
 #include <vector>
@@ -14,7 +15,7 @@ template <typename T>
 class Grid
 {
 private:
-	T ***gridArr; // the grid
+	T *gridArr; // the grid's cells stored by value, row by row
 	int gridWidth; // the width of the grid
 	int gridHeight; // the height of the grid
 	int cellSize; // in pixels
@@ -24,15 +25,25 @@ public:
 
 	T *getValueAt(int x, int y);
 
+	T *getValueAt(int index);
+
+	T *getData();
+
+	int toIndex(int x, int y);
+
+	Vector2i toCoords(int index);
+
+	int getStride();
+
 	Vector2f gridToScreen(int x, int y);
 
 	Vector2i screenToGrid(Vector2i pos);
 
 	Vector2f centerScreenCoord(Vector2i pos);
 
-	bool setValAt(int x, int y, T *val);
+	bool setValAt(int x, int y, const T &val);
 
-	bool setValAt(Vector2i pos, T *val);
+	bool setValAt(Vector2i pos, const T &val);
 
 	int getCellSize();
 
@@ -42,65 +53,41 @@ public:
 
 	bool validCoords(int x, int y);
 
-	vector<T*> *getNeighbours(int x, int y, bool includeDiagonals);
+	int getNeighbourIds(int x, int y, bool includeDiagonals, int *ids);
 	
 	~Grid();
+
+private:
+	Grid(const Grid &other) = delete;
+
+	Grid &operator = (const Grid &other) = delete;
 };
 
 /// <summary>
-/// Get a list of all of the neighbouring cells around the given
-/// grid coordinates
+/// Get the ids of the neighbouring cells around the given grid
+/// coordinates that are inside the grid, without allocating anything
 /// </summary>
 /// <param name="x">the x coordinate of a cell in the grid</param>
-/// <param name="y">the x coordinate of a cellin the grid</param>
-/// <returns>a list of all of the neighbouring cells around the given
-/// grid coordinates if the coordinates are valid and null otherwise</returns>
+/// <param name="y">the y coordinate of a cell in the grid</param>
+/// <param name="includeDiagonals">whether to include the diagonal neighbours</param>
+/// <param name="ids">filled with the ids of the neighbours, needs room for 8</param>
+/// <returns>the number of neighbours</returns>
 template <typename T>
-vector<T*> *Grid<T>::getNeighbours(int x, int y, bool includeDiagonals)
+int Grid<T>::getNeighbourIds(int x, int y, bool includeDiagonals, int *ids)
 {
-	// check for invalid coords
-	if (!validCoords(x, y))
-	{
-		return NULL;
-	}
-
-	// create a list to store the neighbouring cells
-	vector<T*>* neighbours = new vector<T*>();
-
-	// find all neighbours around given coordinates
-	for (int relativeX = -1; relativeX < 2; relativeX++)
+	int count = 0;
+	int directions = neighbourDirections(includeDiagonals);
+	while (directions != 0)
 	{
-		for (int relativeY = -1; relativeY < 2; relativeY++)
+		int neighbour = popNeighbour(&directions);
+		int currX = x + NEIGHBOUR_X_OFFSETS[neighbour];
+		int currY = y + NEIGHBOUR_Y_OFFSETS[neighbour];
+		if (validCoords(currX, currY))
 		{
-			// skip the center cell
-			if (relativeX == 0 && relativeY == 0)
-			{
-				continue;
-			}
-
-			// skip diagonals if needed
-			if (!includeDiagonals)
-			{
-				if ((relativeX == -1 && relativeY == -1)
-					|| (relativeX == -1 && relativeY == 1)
-					|| (relativeX == 1 && relativeY == -1)
-					|| (relativeX == 1 && relativeY == 1))
-				{
-					continue;
-				}
-			}
-
-			int currX = x + relativeX;
-			int currY = y + relativeY;
-			// add neighbouring cell if it exists in the grid
-			if (validCoords(currX, currY))
-			{
-				neighbours->push_back(getValueAt(currX, currY));
-			}
+			ids[count++] = currY * gridWidth + currX;
 		}
 	}
-
-	return neighbours;
+	return count;
 }
 
 /// <summary>
@@ -157,13 +144,8 @@ Vector2f Grid<T>::centerScreenCoord(Vector2i pos)
 template <typename T>
 Grid<T>::Grid(int width, int height, int cellSize)
 {
-	this->cellSize = cellSize;
-	// initialize grid
-	gridArr = new T **[width];
-	for (int x = 0; x < width; x++)
-	{
-		gridArr[x] = new T *[height];
-	}
+	// initialize grid as one contiguous row-major block of cells
+	gridArr = new T[width * height]();
 
 	// initialize instance variables
 	gridWidth = width;
@@ -177,18 +159,74 @@ Grid<T>::Grid(int width, int height, int cellSize)
 /// <param name="relativeX">the row cooridnate</param>
 /// <param name="relativeY">the column coordinate</param>
 /// <returns>if the coordinates are valid, returns the value at the given grid 
-/// coordinates, and returns false otherwise</returns>
+/// coordinates, and returns NULL otherwise</returns>
 template <typename T>
 T *Grid<T>::getValueAt(int x, int y)
 {
-	if (x < gridWidth && y < gridHeight)
+	if (validCoords(x, y))
 	{
-		return gridArr[x][y];
+		return &gridArr[y * gridWidth + x];
 	}
 
 	return NULL;
 }
 
+/// <summary>
+/// Get the value at the given index. Cells are stored row by row so the
+/// index of (x, y) is y * stride + x.
+/// </summary>
+/// <param name="index">the index of a cell in the grid</param>
+/// <returns>the value at the given index</returns>
+template <typename T>
+T *Grid<T>::getValueAt(int index)
+{
+	return &gridArr[index];
+}
+
+/// <summary>
+/// Get the underlying storage of the grid. Cells are stored by value
+/// row by row, getStride() cells apart from one row to the next.
+/// </summary>
+/// <returns>a pointer to the first cell of the grid</returns>
+template <typename T>
+T *Grid<T>::getData()
+{
+	return gridArr;
+}
+
+/// <summary>
+/// Get the index of the cell at the given grid coordinates
+/// </summary>
+/// <param name="x">the x coordinate of a cell in the grid</param>
+/// <param name="y">the y coordinate of a cell in the grid</param>
+/// <returns>the index of the cell</returns>
+template <typename T>
+int Grid<T>::toIndex(int x, int y)
+{
+	return y * gridWidth + x;
+}
+
+/// <summary>
+/// Get the grid coordinates of the cell at the given index
+/// </summary>
+/// <param name="index">the index of a cell in the grid</param>
+/// <returns>the grid coordinates of the cell</returns>
+template <typename T>
+Vector2i Grid<T>::toCoords(int index)
+{
+	return Vector2i(index % gridWidth, index / gridWidth);
+}
+
+/// <summary>
+/// Get the number of cells between a cell and the one directly below it
+/// </summary>
+/// <returns>the distance between two rows in cells</returns>
+template <typename T>
+int Grid<T>::getStride()
+{
+	return gridWidth;
+}
+
 /// <summary>
 /// Convert the grid position to a screen position
 /// </summary>
@@ -239,12 +277,12 @@ bool Grid<T>::validCoords(int x, int y)
 /// <param name="val">the new value of the given cell</param>
 /// <returns>true if the cell is valid and false otherwise</returns>
 template <typename T>
-bool Grid<T>::setValAt(int x, int y, T *val)
+bool Grid<T>::setValAt(int x, int y, const T &val)
 {
 	if (validCoords(x, y))
 	{
 		// set the value at the cell
-		gridArr[x][y] = val;
+		gridArr[y * gridWidth + x] = val;
 
 		return true;
 	}
@@ -260,7 +298,7 @@ bool Grid<T>::setValAt(int x, int y, T *val)
 /// <param name="val">the new value of the cell</param>
 /// <returns>true if the cell is valid and false otherwise</returns>
 template <typename T>
-bool Grid<T>::setValAt(Vector2i pos, T *val)
+bool Grid<T>::setValAt(Vector2i pos, const T &val)
 {
 	Vector2i gridCoords(screenToGrid(pos));
 	return setValAt(gridCoords.x, gridCoords.y, val);
@@ -273,12 +311,7 @@ template <typename T>
 Grid<T>::~Grid()
 {
 	// free the grid array
-	for (int x = 0; x < gridWidth; x++)
-	{
-		delete gridArr[x];
-	}
-
-	delete gridArr;
+	delete[] gridArr;
 }
 
 #endif
@@ -23,6 +23,11 @@ enum class GridStateColor : unsigned long
 	START_COLOR = 0xFFFB00FF // bright yellow
 };
 
+// multiplier of the cost of moving into a passable cell, plain ground
+// costs the least and rough terrain up to the most
+const int MIN_TERRAIN_COST = 1;
+const int MAX_TERRAIN_COST = 9;
+
 GridStateColor valToColor(GridValue val)
 {
 	switch (val)
@@ -42,5 +47,18 @@ GridStateColor valToColor(GridValue val)
 	}
 }
 
+/// <summary>
+/// Get the colour of an unoccupied cell with the given terrain cost,
+/// from transparent for plain ground to solid brown for the roughest
+/// </summary>
+/// <param name="terrainCost">the terrain cost of the cell</param>
+/// <returns>the colour as 0xRRGGBBAA</returns>
+unsigned long terrainToColor(int terrainCost)
+{
+	unsigned long alpha = (unsigned long)(terrainCost - MIN_TERRAIN_COST) * 0xFF
+		/ (MAX_TERRAIN_COST - MIN_TERRAIN_COST);
+	return 0x8B5A2B00 | alpha; // brown
+}
+
 #endif 
 
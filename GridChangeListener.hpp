@@ -0,0 +1,35 @@
+#ifndef GRID_CHANGE_LISTENER_H
+#define GRID_CHANGE_LISTENER_H
+
+#include "GridCellStates.hpp"
+
+/// <summary>
+/// Interface for objects that keep state derived from a PathFinder's grid
+/// and need to hear about every cell whose value changes
+/// </summary>
+class GridChangeListener
+{
+public:
+	/// <summary>
+	/// Called after the value of a cell has changed
+	/// </summary>
+	/// <param name="x">the x coordinate of the cell</param>
+	/// <param name="y">the y coordinate of the cell</param>
+	/// <param name="oldVal">the value the cell had before</param>
+	/// <param name="newVal">the value the cell has now</param>
+	virtual void onCellChanged(int x, int y, GridValue oldVal, GridValue newVal) = 0;
+
+	/// <summary>
+	/// Called after the terrain cost of a cell has changed. Does nothing
+	/// unless overridden, since most state only depends on passability.
+	/// </summary>
+	/// <param name="x">the x coordinate of the cell</param>
+	/// <param name="y">the y coordinate of the cell</param>
+	/// <param name="oldCost">the terrain cost the cell had before</param>
+	/// <param name="newCost">the terrain cost the cell has now</param>
+	virtual void onTerrainChanged(int /*x*/, int /*y*/, int /*oldCost*/, int /*newCost*/) {}
+
+	virtual ~GridChangeListener() {}
+};
+
+#endif
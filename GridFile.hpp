@@ -0,0 +1,291 @@
+#ifndef GRID_FILE_H
+#define GRID_FILE_H
+
+#include "OccupancyGrid.hpp"
+#include <string>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/// <summary>
+/// A grid stored on disk as a 64 byte header followed by the packed
+/// occupancy bits of an OccupancyGrid, little-endian:
+///
+///   offset  size  field
+///   0       8     magic "PFGRID\0\0"
+///   8       4     version, 1
+///   12      4     header size, 64
+///   16      4     width
+///   20      4     height
+///   24      8     offset of the bits from the start of the file
+///   32      8     number of 64-bit words of bits
+///   40      24    reserved, 0
+///
+/// Opening a file maps it into memory instead of reading it, so even huge
+/// grids open instantly and only the pages a search touches are loaded.
+/// The mapping is copy-on-write: a PathFinder built on it can change
+/// cells, but the changes are never written back to the file.
+/// </summary>
+class GridFile
+{
+private:
+	struct Header
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t headerSize;
+		uint32_t width;
+		uint32_t height;
+		uint64_t payloadOffset;
+		uint64_t wordCount;
+		uint8_t reserved[24];
+	};
+	static_assert(sizeof(Header) == 64, "grid file headers are 64 bytes");
+
+	static const uint32_t VERSION = 1;
+
+	void *mappedData; // start of the mapped file, NULL if none is open
+	size_t mappedSize;
+	Header *header;
+	uint64_t *words;
+
+public:
+	GridFile();
+
+	~GridFile();
+
+	bool open(const string &fileName);
+
+	void close();
+
+	bool isOpen();
+
+	int getWidth();
+
+	int getHeight();
+
+	uint64_t *getWords();
+
+	static bool save(const string &fileName, OccupancyGrid *occupancy);
+
+private:
+	static void fillHeader(Header *header, int width, int height, int wordCount);
+
+	// a copy would unmap the file twice
+	GridFile(const GridFile &other) = delete;
+
+	GridFile &operator = (const GridFile &other) = delete;
+};
+
+/// <summary>
+/// Create a GridFile with no file open
+/// </summary>
+GridFile::GridFile()
+{
+	mappedData = NULL;
+	mappedSize = 0;
+	header = NULL;
+	words = NULL;
+}
+
+/// <summary>
+/// Unmap the open file
+/// </summary>
+GridFile::~GridFile()
+{
+	close();
+}
+
+/// <summary>
+/// Map a grid file into memory
+/// </summary>
+/// <param name="fileName">the path of the file</param>
+/// <returns>true if the file was mapped and false if it is missing
+/// or not a valid grid file</returns>
+bool GridFile::open(const string &fileName)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(Header))
+	{
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+	{
+		return false;
+	}
+	mappedData = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	// the view keeps the mapping alive
+	CloseHandle(mapping);
+	if (mappedData == NULL)
+	{
+		return false;
+	}
+	mappedSize = (size_t)fileSize.QuadPart;
+#else
+	int file = ::open(fileName.c_str(), O_RDONLY);
+	if (file == -1)
+	{
+		return false;
+	}
+	struct stat fileInfo;
+	if (fstat(file, &fileInfo) != 0 || fileInfo.st_size < (off_t)sizeof(Header))
+	{
+		::close(file);
+		return false;
+	}
+	void* data = mmap(NULL, (size_t)fileInfo.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	// the mapping stays valid after the file is closed
+	::close(file);
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+	mappedData = data;
+	mappedSize = (size_t)fileInfo.st_size;
+#endif
+
+	// check the header before trusting any of it
+	header = (Header*)mappedData;
+	uint64_t cellCount = (uint64_t)header->width * header->height;
+	bool valid = memcmp(header->magic, "PFGRID\0\0", 8) == 0
+		&& header->version == VERSION
+		&& header->headerSize == sizeof(Header)
+		&& header->width > 0 && header->height > 0 && cellCount <= INT32_MAX
+		&& header->wordCount == (uint64_t)OccupancyGrid::wordsFor((int)cellCount)
+		&& header->payloadOffset % sizeof(uint64_t) == 0
+		&& header->payloadOffset >= sizeof(Header)
+		// compared without adding, so huge values can't wrap around
+		&& header->payloadOffset <= mappedSize
+		&& header->wordCount <= (mappedSize - header->payloadOffset) / sizeof(uint64_t);
+	if (!valid)
+	{
+		close();
+		return false;
+	}
+
+	words = (uint64_t*)((char*)mappedData + header->payloadOffset);
+	return true;
+}
+
+/// <summary>
+/// Unmap the open file, if any. Grids built on it must not be used afterwards.
+/// </summary>
+void GridFile::close()
+{
+	if (mappedData != NULL)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(mappedData);
+#else
+		munmap(mappedData, mappedSize);
+#endif
+	}
+	mappedData = NULL;
+	mappedSize = 0;
+	header = NULL;
+	words = NULL;
+}
+
+/// <summary>
+/// Check if a file is open
+/// </summary>
+/// <returns>true if a file is mapped and false otherwise</returns>
+bool GridFile::isOpen()
+{
+	return mappedData != NULL;
+}
+
+/// <summary>
+/// Get the width of the open grid
+/// </summary>
+/// <returns>the width of the grid</returns>
+int GridFile::getWidth()
+{
+	return (int)header->width;
+}
+
+/// <summary>
+/// Get the height of the open grid
+/// </summary>
+/// <returns>the height of the grid</returns>
+int GridFile::getHeight()
+{
+	return (int)header->height;
+}
+
+/// <summary>
+/// Get the mapped occupancy bits of the open grid, laid out as in an OccupancyGrid
+/// </summary>
+/// <returns>the first word of the bits</returns>
+uint64_t *GridFile::getWords()
+{
+	return words;
+}
+
+/// <summary>
+/// Write an occupancy grid to a grid file
+/// </summary>
+/// <param name="fileName">the path of the file to write</param>
+/// <param name="occupancy">the grid to save</param>
+/// <returns>true if the file was written and false otherwise</returns>
+bool GridFile::save(const string &fileName, OccupancyGrid *occupancy)
+{
+	ofstream file(fileName, ios::binary | ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	Header fileHeader;
+	fillHeader(&fileHeader, occupancy->getWidth(), occupancy->getHeight(), occupancy->getWordCount());
+	file.write((const char*)&fileHeader, sizeof(Header));
+	file.write((const char*)occupancy->getWords(), (streamsize)occupancy->getWordCount() * sizeof(uint64_t));
+	return (bool)file;
+}
+
+/// <summary>
+/// Fill in the header of a grid file
+/// </summary>
+/// <param name="header">the header to fill in</param>
+/// <param name="width">the width of the grid</param>
+/// <param name="height">the height of the grid</param>
+/// <param name="wordCount">the number of words of bits</param>
+void GridFile::fillHeader(Header *header, int width, int height, int wordCount)
+{
+	memset(header, 0, sizeof(Header));
+	memcpy(header->magic, "PFGRID\0\0", 8);
+	header->version = VERSION;
+	header->headerSize = sizeof(Header);
+	header->width = (uint32_t)width;
+	header->height = (uint32_t)height;
+	header->payloadOffset = sizeof(Header);
+	header->wordCount = (uint64_t)wordCount;
+}
+
+#endif
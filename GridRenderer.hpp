@@ -0,0 +1,255 @@
+#ifndef GRID_RENDERER_H
+#define GRID_RENDERER_H
+
+#include <SFML/Graphics.hpp>
+#include "PathFinder.hpp"
+#include "GridChangeListener.hpp"
+#include "GridCellStates.hpp"
+#include <vector>
+
+using namespace std;
+using namespace sf;
+
+/// <summary>
+/// Draws a PathFinder's grid and a path over it with one vertex array
+/// each, instead of a shape per cell.
+///
+/// The grid's vertices are built once: the white lines between the cells,
+/// then one quad per cell inset by the outline thickness so the lines show
+/// around it. The renderer listens for changes to the grid and only
+/// recolours the quad of a cell that changed, so a frame costs the changed
+/// cells plus two draw calls however big the grid is.
+/// </summary>
+class GridRenderer : public GridChangeListener
+{
+private:
+	PathFinder *pathFinder;
+	int outlineThickness;
+	VertexArray gridVertices; // the lines, then 4 per cell in id order
+	int firstCellVertex; // index of the first vertex of the cells
+	VertexArray pathVertices; // 4 per cell of the path overlay
+	Color pathColor;
+
+public:
+	GridRenderer(PathFinder *pathFinder);
+
+	~GridRenderer();
+
+	void onCellChanged(int x, int y, GridValue oldVal, GridValue newVal) override;
+
+	void onTerrainChanged(int x, int y, int oldCost, int newCost) override;
+
+	void setPath(const vector<Vector2i> *path);
+
+	void clearPath();
+
+	void setPathColor(Color color);
+
+	void draw(RenderWindow *window);
+
+private:
+	void addLine(float left, float top, float right, float bottom);
+
+	void setQuad(VertexArray *vertices, int firstVertex, int x, int y, Color color);
+
+	Color cellColor(int x, int y);
+
+	void recolorCell(int x, int y);
+
+	GridRenderer(const GridRenderer &other) = delete;
+
+	GridRenderer &operator = (const GridRenderer &other) = delete;
+};
+
+/// <summary>
+/// Build the vertices of the whole grid and start listening for changes to it
+/// </summary>
+/// <param name="pathFinder">the path finder whose grid is drawn</param>
+GridRenderer::GridRenderer(PathFinder *pathFinder)
+{
+	this->pathFinder = pathFinder;
+	outlineThickness = pathFinder->getOutlineThickness();
+	pathColor = Color::Green;
+	gridVertices.setPrimitiveType(Quads);
+	pathVertices.setPrimitiveType(Quads);
+
+	Grid<PathFinder::GridNode>* grid = pathFinder->getGrid();
+	int gridWidth = grid->getGridWidth();
+	int gridHeight = grid->getGridHeight();
+	float right = gridWidth * grid->getCellSize();
+	float bottom = gridHeight * grid->getCellSize();
+
+	// a line along every cell border, as thick as the outlines of two
+	// neighbouring shapes
+	for (int x = 0; x <= gridWidth; x++)
+	{
+		float lineX = grid->gridToScreen(x, 0).x;
+		addLine(lineX - outlineThickness, -outlineThickness, lineX + outlineThickness, bottom + outlineThickness);
+	}
+	for (int y = 0; y <= gridHeight; y++)
+	{
+		float lineY = grid->gridToScreen(0, y).y;
+		addLine(-outlineThickness, lineY - outlineThickness, right + outlineThickness, lineY + outlineThickness);
+	}
+
+	firstCellVertex = (int)gridVertices.getVertexCount();
+	gridVertices.resize(firstCellVertex + gridWidth * gridHeight * 4);
+	for (int y = 0; y < gridHeight; y++)
+	{
+		for (int x = 0; x < gridWidth; x++)
+		{
+			setQuad(&gridVertices, firstCellVertex + grid->toIndex(x, y) * 4, x, y, cellColor(x, y));
+		}
+	}
+
+	pathFinder->addChangeListener(this);
+}
+
+/// <summary>
+/// Stop listening for changes to the grid
+/// </summary>
+GridRenderer::~GridRenderer()
+{
+	pathFinder->removeChangeListener(this);
+}
+
+/// <summary>
+/// Recolour the quad of a cell that changed
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+/// <param name="oldVal">the value the cell had before</param>
+/// <param name="newVal">the value the cell has now</param>
+void GridRenderer::onCellChanged(int x, int y, GridValue /*oldVal*/, GridValue /*newVal*/)
+{
+	recolorCell(x, y);
+}
+
+/// <summary>
+/// Recolour the quad of a cell whose terrain cost changed
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+/// <param name="oldCost">the terrain cost the cell had before</param>
+/// <param name="newCost">the terrain cost the cell has now</param>
+void GridRenderer::onTerrainChanged(int x, int y, int /*oldCost*/, int /*newCost*/)
+{
+	recolorCell(x, y);
+}
+
+/// <summary>
+/// Show a path over the grid until the next setPath or clearPath
+/// </summary>
+/// <param name="path">the grid positions of the path</param>
+void GridRenderer::setPath(const vector<Vector2i> *path)
+{
+	// resizing keeps the room of longer paths shown before
+	pathVertices.resize(path->size() * 4);
+	for (int i = 0; i < path->size(); i++)
+	{
+		setQuad(&pathVertices, i * 4, (*path)[i].x, (*path)[i].y, pathColor);
+	}
+}
+
+/// <summary>
+/// Stop showing a path
+/// </summary>
+void GridRenderer::clearPath()
+{
+	pathVertices.resize(0);
+}
+
+/// <summary>
+/// Set the colour of the path overlay, used by the next setPath
+/// </summary>
+/// <param name="color">the colour of the path's cells</param>
+void GridRenderer::setPathColor(Color color)
+{
+	pathColor = color;
+}
+
+/// <summary>
+/// Draw the grid, then the path over it
+/// </summary>
+/// <param name="window">window to draw into</param>
+void GridRenderer::draw(RenderWindow *window)
+{
+	window->draw(gridVertices);
+	if (pathVertices.getVertexCount() > 0)
+	{
+		window->draw(pathVertices);
+	}
+}
+
+/// <summary>
+/// Add a white rectangle to the grid's vertices
+/// </summary>
+/// <param name="left">the left edge of the rectangle on screen</param>
+/// <param name="top">the top edge of the rectangle on screen</param>
+/// <param name="right">the right edge of the rectangle on screen</param>
+/// <param name="bottom">the bottom edge of the rectangle on screen</param>
+void GridRenderer::addLine(float left, float top, float right, float bottom)
+{
+	gridVertices.append(Vertex(Vector2f(left, top), Color::White));
+	gridVertices.append(Vertex(Vector2f(right, top), Color::White));
+	gridVertices.append(Vertex(Vector2f(right, bottom), Color::White));
+	gridVertices.append(Vertex(Vector2f(left, bottom), Color::White));
+}
+
+/// <summary>
+/// Place the quad of a cell inside its outline
+/// </summary>
+/// <param name="vertices">the vertex array holding the quad</param>
+/// <param name="firstVertex">the index of the quad's first vertex</param>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+/// <param name="color">the colour of the cell</param>
+void GridRenderer::setQuad(VertexArray *vertices, int firstVertex, int x, int y, Color color)
+{
+	Grid<PathFinder::GridNode>* grid = pathFinder->getGrid();
+	Vector2f topLeft = grid->gridToScreen(x, y);
+	float left = topLeft.x + outlineThickness;
+	float top = topLeft.y + outlineThickness;
+	float right = topLeft.x + grid->getCellSize() - outlineThickness;
+	float bottom = topLeft.y + grid->getCellSize() - outlineThickness;
+
+	VertexArray& quad = *vertices;
+	quad[firstVertex] = Vertex(Vector2f(left, top), color);
+	quad[firstVertex + 1] = Vertex(Vector2f(right, top), color);
+	quad[firstVertex + 2] = Vertex(Vector2f(right, bottom), color);
+	quad[firstVertex + 3] = Vertex(Vector2f(left, bottom), color);
+}
+
+/// <summary>
+/// Get the colour a cell is drawn with, which shows the terrain cost of
+/// unoccupied cells
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+/// <returns>the colour of the cell</returns>
+Color GridRenderer::cellColor(int x, int y)
+{
+	GridValue val = pathFinder->getGrid()->getValueAt(x, y)->val;
+	if (val == GridValue::UNOCCUPIED)
+	{
+		return Color(terrainToColor(pathFinder->getTerrainCostAt(x, y)));
+	}
+	return Color((unsigned long)valToColor(val));
+}
+
+/// <summary>
+/// Set the colour of a cell's quad from its current value and terrain cost
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+void GridRenderer::recolorCell(int x, int y)
+{
+	Color color = cellColor(x, y);
+	int firstVertex = firstCellVertex + pathFinder->getGrid()->toIndex(x, y) * 4;
+	for (int i = 0; i < 4; i++)
+	{
+		gridVertices[firstVertex + i].color = color;
+	}
+}
+
+#endif
@@ -0,0 +1,1000 @@
+#ifndef HIERARCHICAL_PATH_FINDER_H
+#define HIERARCHICAL_PATH_FINDER_H
+
+#include "PathFinder.hpp"
+#include "GridChangeListener.hpp"
+#include "Neighbours.hpp"
+#include "SearchContext.hpp"
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+using namespace sf;
+
+/// <summary>
+/// Hierarchical path finding (HPA*) on top of a PathFinder's grid.
+///
+/// The grid is split into square clusters. Wherever a path can cross from
+/// one cluster into the next, the cells on both sides of the crossing become
+/// entrance nodes of an abstract graph. Nodes in the same cluster are joined
+/// by edges holding the precomputed shortest distance between them inside
+/// the cluster. A query first searches the small abstract graph and then
+/// refines each abstract edge with a search bounded to one cluster, so long
+/// paths only touch the cells along the way.
+///
+/// Paths are near-optimal: they may be slightly longer than the ones found
+/// by PathFinder::findPath because they go through entrance nodes.
+///
+/// Changes made through PathFinder::setValAt only mark the cluster of the
+/// changed cell as dirty. Before the next query the borders of each dirty
+/// cluster are rebuilt, then its intra-cluster distances, then those of the
+/// neighbouring clusters whose shared entrances actually moved.
+/// </summary>
+class HierarchicalPathFinder : public GridChangeListener
+{
+private:
+	// edge of the abstract graph
+	struct Edge
+	{
+		int target; // index of the node at the other end
+		int cost;
+	};
+
+	// entrance cell in the abstract graph
+	struct AbstractNode
+	{
+		Vector2i pos;
+		int cluster;
+		int transitions; // number of border crossings using this node, 0 if unused
+		vector<Edge> intraEdges; // to the nodes of the same cluster
+		vector<Edge> interEdges; // across borders to other clusters
+	};
+
+	// a place where a path crosses a border, given as a pair of cell ids
+	struct Transition
+	{
+		int cell1;
+		int cell2;
+
+		bool operator == (const Transition& other) const
+		{
+			return cell1 == other.cell1 && cell2 == other.cell2;
+		}
+	};
+
+	// square area of the grid
+	struct Cluster
+	{
+		int left;
+		int top;
+		int width;
+		int height;
+		bool dirty; // whether a cell changed since the cluster was last built
+		vector<int> nodes; // entrance nodes inside the cluster
+	};
+
+	// every cluster owns the transitions to the cluster on its right, the
+	// one below, and the two diagonal ones below
+	enum BorderSide
+	{
+		RIGHT_BORDER,
+		BOTTOM_BORDER,
+		BOTTOM_RIGHT_CORNER,
+		BOTTOM_LEFT_CORNER,
+		NUM_OF_BORDER_SIDES
+	};
+
+	// entrances wider than this get two transitions, one at each end
+	static const int MAX_ENTRANCE_WIDTH = 6;
+
+	PathFinder *pathFinder;
+	int gridWidth;
+	int gridHeight;
+	int clusterSize;
+	int clustersWide;
+	int clustersHigh;
+	bool includeDiagonals;
+
+	vector<Cluster> clusters;
+	vector<vector<Transition>> borders; // indexed by cluster * NUM_OF_BORDER_SIDES + side
+	vector<AbstractNode> nodes;
+	vector<int> freeNodes; // unused slots of nodes
+	vector<int> nodeAtCell; // index of the node at each cell, -1 if none
+	bool anyDirty;
+
+	SearchContext *cellContext; // for searches inside a cluster
+	SearchContext *abstractContext; // for searches of the abstract graph
+	vector<int> goalCosts; // cost from each node to the end of the current query, -1 if none
+	vector<Edge> startEdges; // edges from the start of the current query
+	vector<int> startVias; // for each start edge, the id of the neighbour an occupied start steps to first, -1 if none
+	vector<Edge> viaEdges; // edges from one neighbour of an occupied start
+	vector<Edge> endEdges; // edges to the end of the current query
+	vector<Vector2i> waypoints; // positions along the current abstract path
+
+public:
+	HierarchicalPathFinder(PathFinder *pathFinder, int clusterSize, bool includeDiagonals);
+
+	~HierarchicalPathFinder();
+
+	PathFinder::PathStatus findPath(Vector2i start, Vector2i end, vector<Vector2i> *path);
+
+	void onCellChanged(int x, int y, GridValue oldVal, GridValue newVal) override;
+
+	int getClusterSize();
+
+	int getAbstractNodeCount();
+
+private:
+	int clusterAt(int x, int y);
+
+	void rebuildDirtyClusters();
+
+	bool rebuildBorder(int cluster, int side);
+
+	int acrossBorder(int cluster, int side);
+
+	void findBorderTransitions(int cluster, int side, vector<Transition> *transitions);
+
+	void addLineTransitions(Vector2i first1, Vector2i first2, Vector2i step, int length,
+		vector<Transition> *transitions);
+
+	void addCornerTransition(Vector2i cell1, Vector2i cell2, vector<Transition> *transitions);
+
+	int acquireNode(int cellId);
+
+	void releaseNode(int node);
+
+	void removeEdge(vector<Edge> *edges, int target);
+
+	void rebuildIntraEdges(int cluster);
+
+	void searchCluster(int cluster, int startId, int goalId);
+
+	void collectClusterEdges(int cluster, vector<Edge> *edges);
+
+	bool searchAbstract(Vector2i start, Vector2i end);
+
+	void linkOccupiedStart(Vector2i start, Vector2i end, int endNode);
+
+	void relaxAbstractEdge(int curr, const Edge &edge, Vector2i end, int endNode);
+
+	void retraceClusterPath(int fromId, int toId, vector<Vector2i> *path);
+
+	void appendClusterPath(int cluster, Vector2i from, Vector2i to, vector<Vector2i> *path);
+};
+
+/// <summary>
+/// Build the abstract graph of the given PathFinder's grid and start
+/// listening for changes to it
+/// </summary>
+/// <param name="pathFinder">the path finder whose grid is searched</param>
+/// <param name="clusterSize">the width and height of a cluster in cells</param>
+/// <param name="includeDiagonals">whether paths can move diagonally</param>
+HierarchicalPathFinder::HierarchicalPathFinder(PathFinder *pathFinder, int clusterSize, bool includeDiagonals)
+{
+	this->pathFinder = pathFinder;
+	this->clusterSize = clusterSize;
+	this->includeDiagonals = includeDiagonals;
+	gridWidth = pathFinder->getGrid()->getGridWidth();
+	gridHeight = pathFinder->getGrid()->getGridHeight();
+	clustersWide = (gridWidth + clusterSize - 1) / clusterSize;
+	clustersHigh = (gridHeight + clusterSize - 1) / clusterSize;
+
+	// lay out the clusters, the last row and column may be smaller
+	for (int cy = 0; cy < clustersHigh; cy++)
+	{
+		for (int cx = 0; cx < clustersWide; cx++)
+		{
+			Cluster cluster;
+			cluster.left = cx * clusterSize;
+			cluster.top = cy * clusterSize;
+			cluster.width = min(clusterSize, gridWidth - cluster.left);
+			cluster.height = min(clusterSize, gridHeight - cluster.top);
+			cluster.dirty = true;
+			clusters.push_back(cluster);
+		}
+	}
+	borders.resize(clusters.size() * NUM_OF_BORDER_SIDES);
+	nodeAtCell.assign(gridWidth * gridHeight, -1);
+	anyDirty = true;
+
+	cellContext = new SearchContext(gridWidth * gridHeight);
+	abstractContext = new SearchContext();
+
+	rebuildDirtyClusters();
+	pathFinder->addChangeListener(this);
+}
+
+/// <summary>
+/// Stop listening for changes and free the search state
+/// </summary>
+HierarchicalPathFinder::~HierarchicalPathFinder()
+{
+	pathFinder->removeChangeListener(this);
+	delete(cellContext);
+	delete(abstractContext);
+}
+
+/// <summary>
+/// Get the width and height of a cluster
+/// </summary>
+/// <returns>the width and height of a cluster in cells</returns>
+int HierarchicalPathFinder::getClusterSize()
+{
+	return clusterSize;
+}
+
+/// <summary>
+/// Get the number of entrance nodes in the abstract graph
+/// </summary>
+/// <returns>the number of entrance nodes</returns>
+int HierarchicalPathFinder::getAbstractNodeCount()
+{
+	return (int)(nodes.size() - freeNodes.size());
+}
+
+/// <summary>
+/// Mark the cluster of a changed cell as dirty
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+/// <param name="oldVal">the value the cell had before</param>
+/// <param name="newVal">the value the cell has now</param>
+void HierarchicalPathFinder::onCellChanged(int x, int y, GridValue oldVal, GridValue newVal)
+{
+	// only changes between passable and occupied matter
+	if ((oldVal == GridValue::OCCUPIED) == (newVal == GridValue::OCCUPIED))
+	{
+		return;
+	}
+
+	clusters[clusterAt(x, y)].dirty = true;
+	anyDirty = true;
+}
+
+/// <summary>
+/// Get the cluster that holds the given cell
+/// </summary>
+/// <param name="x">the x coordinate of a cell</param>
+/// <param name="y">the y coordinate of a cell</param>
+/// <returns>the index of the cluster</returns>
+int HierarchicalPathFinder::clusterAt(int x, int y)
+{
+	return (y / clusterSize) * clustersWide + x / clusterSize;
+}
+
+/// <summary>
+/// Rebuild the borders and distances of every dirty cluster, and the
+/// distances of the neighbouring clusters whose entrances changed
+/// </summary>
+void HierarchicalPathFinder::rebuildDirtyClusters()
+{
+	if (!anyDirty)
+	{
+		return;
+	}
+
+	vector<bool> needsIntraEdges(clusters.size(), false);
+	for (int c = 0; c < clusters.size(); c++)
+	{
+		if (!clusters[c].dirty)
+		{
+			continue;
+		}
+		needsIntraEdges[c] = true;
+
+		int cx = c % clustersWide;
+		int cy = c / clustersWide;
+		// the borders owned by this cluster and by the clusters that share
+		// a border or corner with it from above or the left. A corner
+		// crossing also depends on the two cells beside it, which are in the
+		// clusters next to both corners, so those corners are rebuilt too.
+		const int NUM_OF_OWNERS = 12;
+		int ownerOffsets[NUM_OF_OWNERS][3] =
+		{
+			{ 0, 0, RIGHT_BORDER }, { 0, 0, BOTTOM_BORDER },
+			{ 0, 0, BOTTOM_RIGHT_CORNER }, { 0, 0, BOTTOM_LEFT_CORNER },
+			{ -1, 0, RIGHT_BORDER }, { 0, -1, BOTTOM_BORDER },
+			{ -1, -1, BOTTOM_RIGHT_CORNER }, { 1, -1, BOTTOM_LEFT_CORNER },
+			{ 0, -1, BOTTOM_RIGHT_CORNER }, { -1, 0, BOTTOM_RIGHT_CORNER },
+			{ 0, -1, BOTTOM_LEFT_CORNER }, { 1, 0, BOTTOM_LEFT_CORNER }
+		};
+		for (int i = 0; i < NUM_OF_OWNERS; i++)
+		{
+			int ownerX = cx + ownerOffsets[i][0];
+			int ownerY = cy + ownerOffsets[i][1];
+			if (ownerX < 0 || ownerX >= clustersWide || ownerY < 0 || ownerY >= clustersHigh)
+			{
+				continue;
+			}
+
+			int owner = ownerY * clustersWide + ownerX;
+			int side = ownerOffsets[i][2];
+			if (rebuildBorder(owner, side))
+			{
+				// the entrances on both sides of the border moved
+				needsIntraEdges[owner] = true;
+				needsIntraEdges[acrossBorder(owner, side)] = true;
+			}
+		}
+	}
+
+	for (int c = 0; c < clusters.size(); c++)
+	{
+		if (needsIntraEdges[c])
+		{
+			rebuildIntraEdges(c);
+		}
+		clusters[c].dirty = false;
+	}
+	anyDirty = false;
+}
+
+/// <summary>
+/// Find the transitions of a border again and update the abstract graph
+/// </summary>
+/// <param name="cluster">the cluster owning the border</param>
+/// <param name="side">which of the cluster's borders to rebuild</param>
+/// <returns>true if the transitions changed and false otherwise</returns>
+bool HierarchicalPathFinder::rebuildBorder(int cluster, int side)
+{
+	vector<Transition> newTransitions;
+	findBorderTransitions(cluster, side, &newTransitions);
+
+	vector<Transition>& oldTransitions = borders[cluster * NUM_OF_BORDER_SIDES + side];
+	if (newTransitions == oldTransitions)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < oldTransitions.size(); i++)
+	{
+		int node1 = nodeAtCell[oldTransitions[i].cell1];
+		int node2 = nodeAtCell[oldTransitions[i].cell2];
+		removeEdge(&nodes[node1].interEdges, node2);
+		removeEdge(&nodes[node2].interEdges, node1);
+		releaseNode(node1);
+		releaseNode(node2);
+	}
+
+	for (int i = 0; i < newTransitions.size(); i++)
+	{
+		int node1 = acquireNode(newTransitions[i].cell1);
+		int node2 = acquireNode(newTransitions[i].cell2);
+		int cost = PathFinder::getDistance(nodes[node1].pos, nodes[node2].pos);
+		nodes[node1].interEdges.push_back(Edge{ node2, cost });
+		nodes[node2].interEdges.push_back(Edge{ node1, cost });
+	}
+
+	oldTransitions = newTransitions;
+	return true;
+}
+
+/// <summary>
+/// Get the cluster on the other side of one of a cluster's borders
+/// </summary>
+/// <param name="cluster">the cluster owning the border</param>
+/// <param name="side">which of the cluster's borders to look across</param>
+/// <returns>the index of the cluster across the border, or -1 if the
+/// border is the edge of the grid</returns>
+int HierarchicalPathFinder::acrossBorder(int cluster, int side)
+{
+	int offsets[NUM_OF_BORDER_SIDES][2] = { { 1, 0 }, { 0, 1 }, { 1, 1 }, { -1, 1 } };
+	int cx = cluster % clustersWide + offsets[side][0];
+	int cy = cluster / clustersWide + offsets[side][1];
+	if (cx < 0 || cx >= clustersWide || cy < 0 || cy >= clustersHigh)
+	{
+		return -1;
+	}
+	return cy * clustersWide + cx;
+}
+
+/// <summary>
+/// Find every place where a path can cross one of a cluster's borders
+/// </summary>
+/// <param name="cluster">the cluster owning the border</param>
+/// <param name="side">which of the cluster's borders to look at</param>
+/// <param name="transitions">filled with the crossings</param>
+void HierarchicalPathFinder::findBorderTransitions(int cluster, int side, vector<Transition> *transitions)
+{
+	Cluster& c = clusters[cluster];
+	int right = c.left + c.width;
+	int bottom = c.top + c.height;
+
+	if (side == RIGHT_BORDER && right < gridWidth)
+	{
+		addLineTransitions(Vector2i(right - 1, c.top), Vector2i(right, c.top),
+			Vector2i(0, 1), c.height, transitions);
+	}
+	else if (side == BOTTOM_BORDER && bottom < gridHeight)
+	{
+		addLineTransitions(Vector2i(c.left, bottom - 1), Vector2i(c.left, bottom),
+			Vector2i(1, 0), c.width, transitions);
+	}
+	else if (side == BOTTOM_RIGHT_CORNER && includeDiagonals
+		&& right < gridWidth && bottom < gridHeight)
+	{
+		addCornerTransition(Vector2i(right - 1, bottom - 1), Vector2i(right, bottom), transitions);
+	}
+	else if (side == BOTTOM_LEFT_CORNER && includeDiagonals
+		&& c.left > 0 && bottom < gridHeight)
+	{
+		addCornerTransition(Vector2i(c.left, bottom - 1), Vector2i(c.left - 1, bottom), transitions);
+	}
+}
+
+/// <summary>
+/// Find the crossings of a straight border. Every run of open cells
+/// facing each other across the border is one entrance, crossed in its
+/// middle, or at both ends if it is wide.
+/// </summary>
+/// <param name="first1">the first cell on the owning cluster's side</param>
+/// <param name="first2">the first cell on the other side</param>
+/// <param name="step">the direction along the border</param>
+/// <param name="length">the number of cells along the border</param>
+/// <param name="transitions">filled with the crossings</param>
+void HierarchicalPathFinder::addLineTransitions(Vector2i first1, Vector2i first2, Vector2i step, int length,
+	vector<Transition> *transitions)
+{
+	Grid<PathFinder::GridNode>* grid = pathFinder->getGrid();
+	int runStart = -1;
+	for (int i = 0; i <= length; i++)
+	{
+		Vector2i cell1(first1.x + step.x * i, first1.y + step.y * i);
+		Vector2i cell2(first2.x + step.x * i, first2.y + step.y * i);
+		bool open = i < length && pathFinder->isWalkable(cell1.x, cell1.y)
+			&& pathFinder->isWalkable(cell2.x, cell2.y);
+
+		if (open && runStart == -1)
+		{
+			runStart = i;
+		}
+		else if (!open && runStart != -1)
+		{
+			// the run of open cells ended
+			int runLength = i - runStart;
+			int positions[2] = { runStart, i - 1 };
+			int numPositions = 2;
+			if (runLength < MAX_ENTRANCE_WIDTH)
+			{
+				positions[0] = runStart + runLength / 2;
+				numPositions = 1;
+			}
+			for (int j = 0; j < numPositions; j++)
+			{
+				int k = positions[j];
+				transitions->push_back(Transition{
+					grid->toIndex(first1.x + step.x * k, first1.y + step.y * k),
+					grid->toIndex(first2.x + step.x * k, first2.y + step.y * k) });
+			}
+			runStart = -1;
+		}
+
+		// a diagonal move can squeeze between two blocked cells on
+		// opposite sides of the border, which no run above covers
+		if (includeDiagonals && i + 1 < length)
+		{
+			Vector2i next1(cell1.x + step.x, cell1.y + step.y);
+			Vector2i next2(cell2.x + step.x, cell2.y + step.y);
+			if (pathFinder->isWalkable(cell1.x, cell1.y) && pathFinder->isWalkable(next2.x, next2.y)
+				&& !pathFinder->isWalkable(cell2.x, cell2.y) && !pathFinder->isWalkable(next1.x, next1.y))
+			{
+				transitions->push_back(Transition{
+					grid->toIndex(cell1.x, cell1.y), grid->toIndex(next2.x, next2.y) });
+			}
+			if (pathFinder->isWalkable(next1.x, next1.y) && pathFinder->isWalkable(cell2.x, cell2.y)
+				&& !pathFinder->isWalkable(cell1.x, cell1.y) && !pathFinder->isWalkable(next2.x, next2.y))
+			{
+				transitions->push_back(Transition{
+					grid->toIndex(next1.x, next1.y), grid->toIndex(cell2.x, cell2.y) });
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Add the diagonal crossing between two clusters that only touch at a
+/// corner, if it is the only way between the two cells
+/// </summary>
+/// <param name="cell1">the corner cell of the owning cluster</param>
+/// <param name="cell2">the corner cell of the diagonal cluster</param>
+/// <param name="transitions">filled with the crossing</param>
+void HierarchicalPathFinder::addCornerTransition(Vector2i cell1, Vector2i cell2, vector<Transition> *transitions)
+{
+	// if either cell between them is open the straight borders
+	// already connect the two cells
+	if (pathFinder->isWalkable(cell1.x, cell1.y) && pathFinder->isWalkable(cell2.x, cell2.y)
+		&& !pathFinder->isWalkable(cell1.x, cell2.y) && !pathFinder->isWalkable(cell2.x, cell1.y))
+	{
+		Grid<PathFinder::GridNode>* grid = pathFinder->getGrid();
+		transitions->push_back(Transition{
+			grid->toIndex(cell1.x, cell1.y), grid->toIndex(cell2.x, cell2.y) });
+	}
+}
+
+/// <summary>
+/// Get the node at a cell, creating it if needed, and count one more
+/// transition using it
+/// </summary>
+/// <param name="cellId">the id of an entrance cell</param>
+/// <returns>the index of the node</returns>
+int HierarchicalPathFinder::acquireNode(int cellId)
+{
+	int node = nodeAtCell[cellId];
+	if (node == -1)
+	{
+		if (freeNodes.empty())
+		{
+			nodes.push_back(AbstractNode());
+			node = (int)nodes.size() - 1;
+		}
+		else
+		{
+			node = freeNodes.back();
+			freeNodes.pop_back();
+		}
+
+		AbstractNode& newNode = nodes[node];
+		newNode.pos = Vector2i(cellId % gridWidth, cellId / gridWidth);
+		newNode.cluster = clusterAt(newNode.pos.x, newNode.pos.y);
+		newNode.transitions = 0;
+		newNode.intraEdges.clear();
+		newNode.interEdges.clear();
+		nodeAtCell[cellId] = node;
+		clusters[newNode.cluster].nodes.push_back(node);
+	}
+
+	nodes[node].transitions++;
+	return node;
+}
+
+/// <summary>
+/// Count one less transition using a node and remove it once none do
+/// </summary>
+/// <param name="node">the index of a node</param>
+void HierarchicalPathFinder::releaseNode(int node)
+{
+	AbstractNode& oldNode = nodes[node];
+	oldNode.transitions--;
+	if (oldNode.transitions > 0)
+	{
+		return;
+	}
+
+	vector<int>& clusterNodes = clusters[oldNode.cluster].nodes;
+	clusterNodes.erase(find(clusterNodes.begin(), clusterNodes.end(), node));
+	nodeAtCell[pathFinder->getGrid()->toIndex(oldNode.pos.x, oldNode.pos.y)] = -1;
+	freeNodes.push_back(node);
+}
+
+/// <summary>
+/// Remove one edge to the given node from a list of edges
+/// </summary>
+/// <param name="edges">a list of edges</param>
+/// <param name="target">the node the edge leads to</param>
+void HierarchicalPathFinder::removeEdge(vector<Edge> *edges, int target)
+{
+	for (int i = 0; i < edges->size(); i++)
+	{
+		if ((*edges)[i].target == target)
+		{
+			edges->erase(edges->begin() + i);
+			return;
+		}
+	}
+}
+
+/// <summary>
+/// Find the shortest distances inside a cluster between all of its nodes
+/// </summary>
+/// <param name="cluster">the index of the cluster</param>
+void HierarchicalPathFinder::rebuildIntraEdges(int cluster)
+{
+	Grid<PathFinder::GridNode>* grid = pathFinder->getGrid();
+	vector<int>& clusterNodes = clusters[cluster].nodes;
+	for (int i = 0; i < clusterNodes.size(); i++)
+	{
+		AbstractNode& node = nodes[clusterNodes[i]];
+		searchCluster(cluster, grid->toIndex(node.pos.x, node.pos.y), -1);
+		collectClusterEdges(cluster, &node.intraEdges);
+		// no need for an edge from a node to itself
+		removeEdge(&node.intraEdges, clusterNodes[i]);
+	}
+}
+
+/// <summary>
+/// Search from a cell without leaving its cluster. The costs found are
+/// left in cellContext.
+/// </summary>
+/// <param name="cluster">the index of the cluster</param>
+/// <param name="startId">the id of the cell to search from</param>
+/// <param name="goalId">the id of the cell to search for, or -1 to
+/// find the distance to every cell of the cluster</param>
+void HierarchicalPathFinder::searchCluster(int cluster, int startId, int goalId)
+{
+	Cluster& c = clusters[cluster];
+	Vector2i goalPos(goalId % gridWidth, goalId / gridWidth);
+
+	cellContext->beginSearch(gridWidth * gridHeight);
+	IndexedHeap<SearchContext::CostCompare>* openList = cellContext->getOpenList();
+
+	Vector2i startPos(startId % gridWidth, startId / gridWidth);
+	cellContext->reach(startId, 0, goalId == -1 ? 0 : PathFinder::getDistance(startPos, goalPos), -1);
+	openList->push(startId);
+
+	while (!openList->isEmpty())
+	{
+		int currId = openList->pop();
+		cellContext->close(currId);
+		if (currId == goalId)
+		{
+			return;
+		}
+
+		Vector2i currPos(currId % gridWidth, currId / gridWidth);
+		int neighbours = pathFinder->getOccupancy()->getPassableNeighbours(currPos.x, currPos.y)
+			& neighbourDirections(includeDiagonals);
+		while (neighbours != 0)
+		{
+			int neighbour = popNeighbour(&neighbours);
+			// stay inside the cluster
+			Vector2i neighbourPos(currPos.x + NEIGHBOUR_X_OFFSETS[neighbour],
+				currPos.y + NEIGHBOUR_Y_OFFSETS[neighbour]);
+			if (neighbourPos.x < c.left || neighbourPos.x >= c.left + c.width
+				|| neighbourPos.y < c.top || neighbourPos.y >= c.top + c.height)
+			{
+				continue;
+			}
+
+			int neighbourId = neighbourPos.y * gridWidth + neighbourPos.x;
+			bool isReached = cellContext->isReached(neighbourId);
+			if (isReached && cellContext->isClosed(neighbourId))
+			{
+				continue;
+			}
+
+			int newCost = cellContext->getGCost(currId) + PathFinder::getDistance(currPos, neighbourPos);
+			if (!isReached)
+			{
+				int hCost = goalId == -1 ? 0 : PathFinder::getDistance(neighbourPos, goalPos);
+				cellContext->reach(neighbourId, newCost, hCost, currId);
+				openList->push(neighbourId);
+			}
+			else if (newCost < cellContext->getGCost(neighbourId))
+			{
+				cellContext->setGCost(neighbourId, newCost, currId);
+				openList->decreaseKey(neighbourId);
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Turn the distances found by the last full searchCluster into edges
+/// to the nodes of the cluster
+/// </summary>
+/// <param name="cluster">the index of the cluster that was searched</param>
+/// <param name="edges">filled with an edge to every node that was reached</param>
+void HierarchicalPathFinder::collectClusterEdges(int cluster, vector<Edge> *edges)
+{
+	edges->clear();
+	vector<int>& clusterNodes = clusters[cluster].nodes;
+	for (int i = 0; i < clusterNodes.size(); i++)
+	{
+		Vector2i pos = nodes[clusterNodes[i]].pos;
+		int cellId = pos.y * gridWidth + pos.x;
+		if (cellContext->isReached(cellId))
+		{
+			edges->push_back(Edge{ clusterNodes[i], cellContext->getGCost(cellId) });
+		}
+	}
+}
+
+/// <summary>
+/// Find a path between two grid positions through the abstract graph
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="path">filled with the grid positions of the path starting
+/// after the start and ending with the end if a path is found</param>
+/// <returns>whether a path was found</returns>
+PathFinder::PathStatus HierarchicalPathFinder::findPath(Vector2i start, Vector2i end, vector<Vector2i> *path)
+{
+	Grid<PathFinder::GridNode>* grid = pathFinder->getGrid();
+	if (!grid->validCoords(start.x, start.y) || !grid->validCoords(end.x, end.y))
+	{
+		return PathFinder::PathStatus::INVALID_ENDPOINTS;
+	}
+
+	rebuildDirtyClusters();
+	path->clear();
+
+	// already there, even if the start is occupied
+	if (start == end)
+	{
+		return PathFinder::PathStatus::FOUND;
+	}
+	if (!pathFinder->isWalkable(end.x, end.y))
+	{
+		return PathFinder::PathStatus::UNREACHABLE;
+	}
+
+	int startCluster = clusterAt(start.x, start.y);
+	int endCluster = clusterAt(end.x, end.y);
+	int startId = grid->toIndex(start.x, start.y);
+	int endId = grid->toIndex(end.x, end.y);
+
+	// a path that stays in one cluster needs no abstract search
+	if (startCluster == endCluster)
+	{
+		searchCluster(startCluster, startId, endId);
+		if (cellContext->isReached(endId))
+		{
+			retraceClusterPath(startId, endId, path);
+			return PathFinder::PathStatus::FOUND;
+		}
+	}
+
+	if (!searchAbstract(start, end))
+	{
+		return PathFinder::PathStatus::UNREACHABLE;
+	}
+
+	// refine every abstract edge into cells
+	for (int i = 1; i < waypoints.size(); i++)
+	{
+		Vector2i from = waypoints[i - 1];
+		Vector2i to = waypoints[i];
+		int fromCluster = clusterAt(from.x, from.y);
+		if (fromCluster == clusterAt(to.x, to.y))
+		{
+			appendClusterPath(fromCluster, from, to, path);
+		}
+		else
+		{
+			// crossing a border is a single move
+			path->push_back(to);
+		}
+	}
+
+	return PathFinder::PathStatus::FOUND;
+}
+
+/// <summary>
+/// Search the abstract graph from start to end. The start and end are
+/// linked to the nodes of their clusters for this search only. On success
+/// waypoints holds the positions along the abstract path.
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <returns>true if the end was reached and false otherwise</returns>
+bool HierarchicalPathFinder::searchAbstract(Vector2i start, Vector2i end)
+{
+	int startCluster = clusterAt(start.x, start.y);
+	int endCluster = clusterAt(end.x, end.y);
+	int numNodes = (int)nodes.size();
+	int startNode = numNodes;
+	int endNode = numNodes + 1;
+
+	// link the start and end to the nodes of their clusters
+	if (pathFinder->isWalkable(start.x, start.y))
+	{
+		searchCluster(startCluster, start.y * gridWidth + start.x, -1);
+		collectClusterEdges(startCluster, &startEdges);
+		startVias.assign(startEdges.size(), -1);
+	}
+	else
+	{
+		linkOccupiedStart(start, end, endNode);
+	}
+	searchCluster(endCluster, end.y * gridWidth + end.x, -1);
+	collectClusterEdges(endCluster, &endEdges);
+
+	if (goalCosts.size() < numNodes)
+	{
+		goalCosts.assign(numNodes, -1);
+	}
+	for (int i = 0; i < endEdges.size(); i++)
+	{
+		goalCosts[endEdges[i].target] = endEdges[i].cost;
+	}
+
+	abstractContext->beginSearch(numNodes + 2);
+	IndexedHeap<SearchContext::CostCompare>* openList = abstractContext->getOpenList();
+	abstractContext->reach(startNode, 0, PathFinder::getDistance(start, end), -1);
+	openList->push(startNode);
+
+	bool found = false;
+	while (!openList->isEmpty())
+	{
+		int curr = openList->pop();
+		abstractContext->close(curr);
+		if (curr == endNode)
+		{
+			found = true;
+			break;
+		}
+
+		// the start only has its temporary edges, the nodes have their own
+		// edges plus one to the end if they share its cluster
+		if (curr == startNode)
+		{
+			for (int i = 0; i < startEdges.size(); i++)
+			{
+				relaxAbstractEdge(curr, startEdges[i], end, endNode);
+			}
+			continue;
+		}
+
+		AbstractNode& node = nodes[curr];
+		for (int i = 0; i < node.intraEdges.size(); i++)
+		{
+			relaxAbstractEdge(curr, node.intraEdges[i], end, endNode);
+		}
+		for (int i = 0; i < node.interEdges.size(); i++)
+		{
+			relaxAbstractEdge(curr, node.interEdges[i], end, endNode);
+		}
+		if (goalCosts[curr] != -1)
+		{
+			relaxAbstractEdge(curr, Edge{ endNode, goalCosts[curr] }, end, endNode);
+		}
+	}
+
+	// forget the temporary links to the end
+	for (int i = 0; i < endEdges.size(); i++)
+	{
+		goalCosts[endEdges[i].target] = -1;
+	}
+
+	if (!found)
+	{
+		return false;
+	}
+
+	// walk back from the end to list the positions along the way
+	waypoints.clear();
+	int nextStop = -1; // the stop after the current one along the path
+	for (int curr = endNode; curr != -1; curr = abstractContext->getParent(curr))
+	{
+		if (curr == endNode)
+		{
+			waypoints.push_back(end);
+		}
+		else if (curr == startNode)
+		{
+			// an occupied start first steps to the neighbour its edge leads through
+			int via = startVias[find_if(startEdges.begin(), startEdges.end(),
+				[nextStop](const Edge& edge) { return edge.target == nextStop; }) - startEdges.begin()];
+			if (via != -1)
+			{
+				waypoints.push_back(Vector2i(via % gridWidth, via / gridWidth));
+			}
+			waypoints.push_back(start);
+		}
+		else
+		{
+			waypoints.push_back(nodes[curr].pos);
+		}
+		nextStop = curr;
+	}
+	reverse(waypoints.begin(), waypoints.end());
+	return true;
+}
+
+/// <summary>
+/// Link an occupied start to the abstract graph through its passable
+/// neighbours, since like the flat search a path can step off an occupied
+/// start onto any of them, even one in another cluster. Each edge is
+/// the cheapest way through a neighbour to a node of that neighbour's
+/// cluster, or straight to the end if it is in the same cluster.
+/// </summary>
+/// <param name="start">the occupied grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="endNode">the index standing for the end in abstractContext</param>
+void HierarchicalPathFinder::linkOccupiedStart(Vector2i start, Vector2i end, int endNode)
+{
+	startEdges.clear();
+	startVias.clear();
+	int endId = end.y * gridWidth + end.x;
+	int neighbours = pathFinder->getOccupancy()->getPassableNeighbours(start.x, start.y)
+		& neighbourDirections(includeDiagonals);
+	while (neighbours != 0)
+	{
+		int neighbour = popNeighbour(&neighbours);
+		Vector2i viaPos(start.x + NEIGHBOUR_X_OFFSETS[neighbour], start.y + NEIGHBOUR_Y_OFFSETS[neighbour]);
+		int viaId = viaPos.y * gridWidth + viaPos.x;
+		int viaCluster = clusterAt(viaPos.x, viaPos.y);
+		int stepCost = PathFinder::getDistance(start, viaPos);
+
+		searchCluster(viaCluster, viaId, -1);
+		collectClusterEdges(viaCluster, &viaEdges);
+		if (viaCluster == clusterAt(end.x, end.y) && cellContext->isReached(endId))
+		{
+			viaEdges.push_back(Edge{ endNode, cellContext->getGCost(endId) });
+		}
+
+		// keep the cheapest edge to each node over all the neighbours
+		for (int i = 0; i < viaEdges.size(); i++)
+		{
+			Edge edge{ viaEdges[i].target, stepCost + viaEdges[i].cost };
+			auto existing = find_if(startEdges.begin(), startEdges.end(),
+				[&edge](const Edge& other) { return other.target == edge.target; });
+			if (existing == startEdges.end())
+			{
+				startEdges.push_back(edge);
+				startVias.push_back(viaId);
+			}
+			else if (edge.cost < existing->cost)
+			{
+				existing->cost = edge.cost;
+				startVias[existing - startEdges.begin()] = viaId;
+			}
+		}
+	}
+}
+
+/// <summary>
+/// Update the cost of the node at the end of an abstract edge if the
+/// edge is a shorter way to reach it
+/// </summary>
+/// <param name="curr">the node being expanded</param>
+/// <param name="edge">an edge leaving the node</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="endNode">the index standing for the end in abstractContext</param>
+void HierarchicalPathFinder::relaxAbstractEdge(int curr, const Edge &edge, Vector2i end, int endNode)
+{
+	int target = edge.target;
+	bool isReached = abstractContext->isReached(target);
+	if (isReached && abstractContext->isClosed(target))
+	{
+		return;
+	}
+
+	int newCost = abstractContext->getGCost(curr) + edge.cost;
+	if (!isReached)
+	{
+		Vector2i targetPos = (target == endNode) ? end : nodes[target].pos;
+		abstractContext->reach(target, newCost, PathFinder::getDistance(targetPos, end), curr);
+		abstractContext->getOpenList()->push(target);
+	}
+	else if (newCost < abstractContext->getGCost(target))
+	{
+		abstractContext->setGCost(target, newCost, curr);
+		abstractContext->getOpenList()->decreaseKey(target);
+	}
+}
+
+/// <summary>
+/// Add the cells of the shortest path between two cells of a cluster
+/// to the end of a path
+/// </summary>
+/// <param name="cluster">the cluster holding both cells</param>
+/// <param name="from">the cell to start from, which is not added</param>
+/// <param name="to">the cell to reach, which is added last</param>
+/// <param name="path">the path to add to</param>
+void HierarchicalPathFinder::appendClusterPath(int cluster, Vector2i from, Vector2i to, vector<Vector2i> *path)
+{
+	int fromId = from.y * gridWidth + from.x;
+	int toId = to.y * gridWidth + to.x;
+	searchCluster(cluster, fromId, toId);
+	retraceClusterPath(fromId, toId, path);
+}
+
+/// <summary>
+/// Add the path found by the last searchCluster to the end of a path
+/// </summary>
+/// <param name="fromId">the id of the cell the search started from, which is not added</param>
+/// <param name="toId">the id of a cell the search reached, which is added last</param>
+/// <param name="path">the path to add to</param>
+void HierarchicalPathFinder::retraceClusterPath(int fromId, int toId, vector<Vector2i> *path)
+{
+	size_t firstNew = path->size();
+	for (int currId = toId; currId != fromId; currId = cellContext->getParent(currId))
+	{
+		path->push_back(Vector2i(currId % gridWidth, currId / gridWidth));
+	}
+	reverse(path->begin() + firstNew, path->end());
+}
+
+#endif
@@ -0,0 +1,512 @@
+#ifndef INCREMENTAL_PATH_FINDER_H
+#define INCREMENTAL_PATH_FINDER_H
+
+#include "PathFinder.hpp"
+#include "GridChangeListener.hpp"
+#include "Neighbours.hpp"
+#include "IndexedHeap.hpp"
+#include <vector>
+#include <climits>
+#include <algorithm>
+
+using namespace std;
+using namespace sf;
+
+/// <summary>
+/// Incremental shortest paths (D* Lite) on top of a PathFinder's grid.
+///
+/// The search runs backwards from the end, so the distance of every cell it
+/// settles is a distance to the end. The search state is kept between
+/// queries. When cells change through PathFinder::setValAt only the cells
+/// whose distance to the end is affected are searched again, and when only
+/// the start moves the old state is reused as is, with the heuristic
+/// corrected by the distance the start moved.
+///
+/// Paths cost the same as the ones found by PathFinder::findPath. A new end
+/// or a change of diagonal mode starts the search over.
+/// </summary>
+class IncrementalPathFinder : public GridChangeListener
+{
+private:
+	// orders cell ids in the queue by lowest first key, then lowest second key
+	struct KeyCompare
+	{
+		IncrementalPathFinder *finder;
+
+		bool operator() (int id1, int id2) const
+		{
+			return finder->keys1[id1] < finder->keys1[id2]
+				|| (finder->keys1[id1] == finder->keys1[id2] && finder->keys2[id1] < finder->keys2[id2]);
+		}
+	};
+
+	// cost of a cell that can't reach the end
+	static const int INFINITE_COST = INT_MAX / 4;
+
+	PathFinder *pathFinder;
+	int gridWidth;
+	int gridHeight;
+
+	bool hasSearch; // whether there is a search to repair
+	bool includeDiagonals; // diagonal mode of the current search
+	Vector2i start; // start of the previous query
+	Vector2i end; // end of the current search
+	int keyModifier; // total distance the start moved since the search began
+
+	unsigned int generation; // stamp of the current search
+	vector<unsigned int> stamps; // search in which each cell's costs were last set
+	vector<int> gCosts; // settled distance of each cell to the end
+	vector<int> rhsCosts; // distance of each cell to the end through its best neighbour
+	vector<int> keys1; // queue keys of each cell
+	vector<int> keys2;
+	IndexedHeap<KeyCompare> queue; // cells whose gcost and rhscost differ
+
+	vector<int> changedCells; // cells whose passability changed since the last query
+	int expandedCount; // cells expanded by the last query
+
+public:
+	IncrementalPathFinder(PathFinder *pathFinder);
+
+	~IncrementalPathFinder();
+
+	PathFinder::PathStatus findPath(Vector2i start, Vector2i end, bool includeDiagonals, vector<Vector2i> *path);
+
+	void onCellChanged(int x, int y, GridValue oldVal, GridValue newVal) override;
+
+	void reset();
+
+	int getExpandedCount();
+
+private:
+	void beginSearch(Vector2i start, Vector2i end, bool includeDiagonals);
+
+	void repairChangedCells();
+
+	int getGCost(int id);
+
+	int getRhsCost(int id);
+
+	void setCosts(int id, int gCost, int rhsCost);
+
+	void computeKey(int id, int *key1, int *key2);
+
+	void setKey(int id);
+
+	bool keyLess(int id, int key1, int key2);
+
+	void updateCell(int id);
+
+	void updateNeighbours(int id);
+
+	void computeShortestPath(int startId);
+
+	int moveCost(int fromId, int toId);
+
+	// the queue points back at this object
+	IncrementalPathFinder(const IncrementalPathFinder &other) = delete;
+
+	IncrementalPathFinder &operator = (const IncrementalPathFinder &other) = delete;
+};
+
+/// <summary>
+/// Create a planner for the given PathFinder's grid and start
+/// listening for changes to it
+/// </summary>
+/// <param name="pathFinder">the path finder whose grid is searched</param>
+IncrementalPathFinder::IncrementalPathFinder(PathFinder *pathFinder)
+	: queue(0, KeyCompare{ this })
+{
+	this->pathFinder = pathFinder;
+	gridWidth = pathFinder->getGrid()->getGridWidth();
+	gridHeight = pathFinder->getGrid()->getGridHeight();
+
+	int cellCount = gridWidth * gridHeight;
+	stamps.assign(cellCount, 0);
+	gCosts.resize(cellCount);
+	rhsCosts.resize(cellCount);
+	keys1.resize(cellCount);
+	keys2.resize(cellCount);
+	queue.setCapacity(cellCount);
+
+	generation = 0;
+	hasSearch = false;
+	includeDiagonals = false;
+	keyModifier = 0;
+	expandedCount = 0;
+
+	pathFinder->addChangeListener(this);
+}
+
+/// <summary>
+/// Stop listening for changes
+/// </summary>
+IncrementalPathFinder::~IncrementalPathFinder()
+{
+	pathFinder->removeChangeListener(this);
+}
+
+/// <summary>
+/// Remember a cell whose passability changed so the search can be
+/// repaired around it on the next query
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+/// <param name="oldVal">the value the cell had before</param>
+/// <param name="newVal">the value the cell has now</param>
+void IncrementalPathFinder::onCellChanged(int x, int y, GridValue oldVal, GridValue newVal)
+{
+	// only changes between passable and occupied matter
+	if (!hasSearch || (oldVal == GridValue::OCCUPIED) == (newVal == GridValue::OCCUPIED))
+	{
+		return;
+	}
+
+	changedCells.push_back(y * gridWidth + x);
+}
+
+/// <summary>
+/// Throw away the search state so the next query starts over
+/// </summary>
+void IncrementalPathFinder::reset()
+{
+	hasSearch = false;
+	changedCells.clear();
+}
+
+/// <summary>
+/// Get the number of cells expanded by the last query
+/// </summary>
+/// <returns>the number of cells expanded by the last query</returns>
+int IncrementalPathFinder::getExpandedCount()
+{
+	return expandedCount;
+}
+
+/// <summary>
+/// Find the shortest path between two grid positions, reusing as much of
+/// the previous query's search as possible
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="path">filled with the grid positions of the path starting
+/// after the start and ending with the end if a path is found</param>
+/// <returns>whether a path was found</returns>
+PathFinder::PathStatus IncrementalPathFinder::findPath(Vector2i start, Vector2i end, bool includeDiagonals,
+	vector<Vector2i> *path)
+{
+	Grid<PathFinder::GridNode>* grid = pathFinder->getGrid();
+	if (!grid->validCoords(start.x, start.y) || !grid->validCoords(end.x, end.y))
+	{
+		return PathFinder::PathStatus::INVALID_ENDPOINTS;
+	}
+
+	expandedCount = 0;
+	if (!hasSearch || end != this->end || includeDiagonals != this->includeDiagonals)
+	{
+		beginSearch(start, end, includeDiagonals);
+	}
+	else
+	{
+		// keys already in the queue were made for the old start, which was
+		// this much closer to them at most, so raise every new key by as much
+		keyModifier += PathFinder::getDistance(this->start, start);
+		this->start = start;
+		repairChangedCells();
+	}
+
+	int startId = grid->toIndex(start.x, start.y);
+	computeShortestPath(startId);
+
+	if (getRhsCost(startId) >= INFINITE_COST)
+	{
+		return PathFinder::PathStatus::UNREACHABLE;
+	}
+
+	// walk downhill from the start, always to the neighbour with the
+	// lowest cost to the end through it
+	path->clear();
+	int endId = grid->toIndex(end.x, end.y);
+	int currId = startId;
+	while (currId != endId)
+	{
+		Vector2i currPos = grid->toCoords(currId);
+		int bestId = -1;
+		int bestCost = INFINITE_COST;
+		// occupied neighbours cost INFINITE_COST to move to, so only passable ones can be best
+		int neighbours = pathFinder->getOccupancy()->getPassableNeighbours(currPos.x, currPos.y)
+			& neighbourDirections(includeDiagonals);
+		while (neighbours != 0)
+		{
+			int neighbour = popNeighbour(&neighbours);
+			int neighbourId = grid->toIndex(currPos.x + NEIGHBOUR_X_OFFSETS[neighbour],
+				currPos.y + NEIGHBOUR_Y_OFFSETS[neighbour]);
+			int cost = moveCost(currId, neighbourId) + getGCost(neighbourId);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestId = neighbourId;
+			}
+		}
+
+		// can only happen if the search state is broken, but never loop forever
+		if (bestId == -1 || (int)path->size() >= gridWidth * gridHeight)
+		{
+			path->clear();
+			return PathFinder::PathStatus::UNREACHABLE;
+		}
+		path->push_back(grid->toCoords(bestId));
+		currId = bestId;
+	}
+
+	return PathFinder::PathStatus::FOUND;
+}
+
+/// <summary>
+/// Forget the previous search and start a new one from the given end
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+void IncrementalPathFinder::beginSearch(Vector2i start, Vector2i end, bool includeDiagonals)
+{
+	this->start = start;
+	this->end = end;
+	this->includeDiagonals = includeDiagonals;
+	keyModifier = 0;
+	hasSearch = true;
+	changedCells.clear();
+	queue.clear();
+
+	generation++;
+	// start over once the stamps wrap around so old stamps can't match
+	if (generation == UINT_MAX)
+	{
+		stamps.assign(stamps.size(), 0);
+		generation = 1;
+	}
+
+	// the search grows backwards from the end
+	int endId = end.y * gridWidth + end.x;
+	setCosts(endId, INFINITE_COST, 0);
+	setKey(endId);
+	queue.push(endId);
+}
+
+/// <summary>
+/// Update the cells whose distance to the end may have changed because a
+/// neighbour's passability changed. Moving into a cell is what gets
+/// blocked, so those are the changed cells' neighbours.
+/// </summary>
+void IncrementalPathFinder::repairChangedCells()
+{
+	for (int i = 0; i < changedCells.size(); i++)
+	{
+		updateNeighbours(changedCells[i]);
+	}
+	changedCells.clear();
+}
+
+/// <summary>
+/// Get the settled distance of a cell to the end
+/// </summary>
+/// <param name="id">the id of a cell</param>
+/// <returns>the gcost of the cell, INFINITE_COST if not settled</returns>
+int IncrementalPathFinder::getGCost(int id)
+{
+	return stamps[id] == generation ? gCosts[id] : INFINITE_COST;
+}
+
+/// <summary>
+/// Get the distance of a cell to the end through its best neighbour
+/// </summary>
+/// <param name="id">the id of a cell</param>
+/// <returns>the rhs cost of the cell, INFINITE_COST if not known</returns>
+int IncrementalPathFinder::getRhsCost(int id)
+{
+	return stamps[id] == generation ? rhsCosts[id] : INFINITE_COST;
+}
+
+/// <summary>
+/// Set both costs of a cell for the current search
+/// </summary>
+/// <param name="id">the id of a cell</param>
+/// <param name="gCost">the settled distance to the end</param>
+/// <param name="rhsCost">the distance to the end through the best neighbour</param>
+void IncrementalPathFinder::setCosts(int id, int gCost, int rhsCost)
+{
+	stamps[id] = generation;
+	gCosts[id] = gCost;
+	rhsCosts[id] = rhsCost;
+}
+
+/// <summary>
+/// Work out the queue keys of a cell from its costs and the current start
+/// </summary>
+/// <param name="id">the id of a cell</param>
+/// <param name="key1">set to the estimated length of the path through the cell</param>
+/// <param name="key2">set to the cell's distance to the end</param>
+void IncrementalPathFinder::computeKey(int id, int *key1, int *key2)
+{
+	int cost = min(getGCost(id), getRhsCost(id));
+	Vector2i pos(id % gridWidth, id / gridWidth);
+	*key2 = cost;
+	*key1 = cost >= INFINITE_COST ? INFINITE_COST
+		: cost + PathFinder::getDistance(start, pos) + keyModifier;
+}
+
+/// <summary>
+/// Store the queue keys of a cell. The heap order must be restored
+/// afterwards if the cell is in the queue.
+/// </summary>
+/// <param name="id">the id of a cell</param>
+void IncrementalPathFinder::setKey(int id)
+{
+	computeKey(id, &keys1[id], &keys2[id]);
+}
+
+/// <summary>
+/// Check if a cell's queue keys come before the given keys
+/// </summary>
+/// <param name="id">the id of a cell in the queue</param>
+/// <param name="key1">the first key to compare with</param>
+/// <param name="key2">the second key to compare with</param>
+/// <returns>true if the cell's keys are smaller and false otherwise</returns>
+bool IncrementalPathFinder::keyLess(int id, int key1, int key2)
+{
+	return keys1[id] < key1 || (keys1[id] == key1 && keys2[id] < key2);
+}
+
+/// <summary>
+/// Get the cost of moving between two neighbouring cells
+/// </summary>
+/// <param name="fromId">the id of the cell moved from</param>
+/// <param name="toId">the id of the cell moved to</param>
+/// <returns>the cost of the move, INFINITE_COST if the cell moved
+/// to is occupied</returns>
+int IncrementalPathFinder::moveCost(int fromId, int toId)
+{
+	Vector2i toPos(toId % gridWidth, toId / gridWidth);
+	if (!pathFinder->isWalkable(toPos.x, toPos.y))
+	{
+		return INFINITE_COST;
+	}
+	return PathFinder::getDistance(Vector2i(fromId % gridWidth, fromId / gridWidth), toPos);
+}
+
+/// <summary>
+/// Recompute a cell's distance through its best neighbour and put it in
+/// the queue if that no longer matches its settled distance
+/// </summary>
+/// <param name="id">the id of a cell</param>
+void IncrementalPathFinder::updateCell(int id)
+{
+	int x = id % gridWidth;
+	int y = id / gridWidth;
+	int rhsCost = getRhsCost(id);
+	if (x != end.x || y != end.y)
+	{
+		rhsCost = INFINITE_COST;
+		int neighbours = pathFinder->getOccupancy()->getPassableNeighbours(x, y)
+			& neighbourDirections(includeDiagonals);
+		while (neighbours != 0)
+		{
+			int neighbour = popNeighbour(&neighbours);
+			int neighbourId = id + NEIGHBOUR_Y_OFFSETS[neighbour] * gridWidth + NEIGHBOUR_X_OFFSETS[neighbour];
+			int neighbourCost = getGCost(neighbourId);
+			if (neighbourCost < INFINITE_COST)
+			{
+				rhsCost = min(rhsCost, moveCost(id, neighbourId) + neighbourCost);
+			}
+		}
+		rhsCost = min(rhsCost, (int)INFINITE_COST);
+	}
+	int gCost = getGCost(id);
+	setCosts(id, gCost, rhsCost);
+
+	bool queued = queue.contains(id);
+	if (gCost != rhsCost)
+	{
+		setKey(id);
+		if (queued)
+		{
+			queue.updateKey(id);
+		}
+		else
+		{
+			queue.push(id);
+		}
+	}
+	else if (queued)
+	{
+		queue.remove(id);
+	}
+}
+
+/// <summary>
+/// Update every neighbour of a cell, which are the cells that can move into it
+/// </summary>
+/// <param name="id">the id of a cell</param>
+void IncrementalPathFinder::updateNeighbours(int id)
+{
+	int neighbourIds[EightConnected::NUM_OF_NEIGHBOURS];
+	int numOfNeighbours = pathFinder->getGrid()->getNeighbourIds(id % gridWidth, id / gridWidth,
+		includeDiagonals, neighbourIds);
+	for (int i = 0; i < numOfNeighbours; i++)
+	{
+		updateCell(neighbourIds[i]);
+	}
+}
+
+/// <summary>
+/// Settle cells in key order until the start's distance to the end is known
+/// </summary>
+/// <param name="startId">the id of the starting cell</param>
+void IncrementalPathFinder::computeShortestPath(int startId)
+{
+	int startKey1;
+	int startKey2;
+	computeKey(startId, &startKey1, &startKey2);
+
+	while (!queue.isEmpty()
+		&& (keyLess(queue.top(), startKey1, startKey2) || getRhsCost(startId) > getGCost(startId)))
+	{
+		int currId = queue.top();
+		int newKey1;
+		int newKey2;
+		computeKey(currId, &newKey1, &newKey2);
+
+		if (keyLess(currId, newKey1, newKey2))
+		{
+			// the key was made for an older start, queue it again with the new one
+			keys1[currId] = newKey1;
+			keys2[currId] = newKey2;
+			queue.updateKey(currId);
+		}
+		else
+		{
+			int gCost = getGCost(currId);
+			int rhsCost = getRhsCost(currId);
+			expandedCount++;
+			if (gCost > rhsCost)
+			{
+				// the cell got closer to the end, settle it and pass it on
+				queue.pop();
+				setCosts(currId, rhsCost, rhsCost);
+				updateNeighbours(currId);
+			}
+			else
+			{
+				// the cell got further from the end, unsettle it and let
+				// it and its neighbours find their new best neighbour
+				setCosts(currId, INFINITE_COST, rhsCost);
+				updateCell(currId);
+				updateNeighbours(currId);
+			}
+		}
+
+		computeKey(startId, &startKey1, &startKey2);
+	}
+}
+
+#endif
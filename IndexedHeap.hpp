@@ -0,0 +1,285 @@
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+#include <vector>
+
+using namespace std;
+
+/// <summary>
+/// A binary min heap of integer ids in the range [0, capacity) that
+/// remembers where every id is stored. This gives O(1) membership checks
+/// and O(log n) decrease-key on top of the usual push and pop.
+/// Compare(a, b) must return true if id a should be popped before id b.
+/// </summary>
+template <typename Compare>
+class IndexedHeap
+{
+private:
+	vector<int> heap; // ids in heap order
+	vector<int> positions; // position of each id in the heap, -1 if absent
+	Compare compare; // ordering of the ids
+
+public:
+	IndexedHeap(int capacity, Compare compare);
+
+	void setCapacity(int capacity);
+
+	void setCompare(Compare compare);
+
+	bool isEmpty();
+
+	int size();
+
+	bool contains(int id);
+
+	void push(int id);
+
+	int top();
+
+	int pop();
+
+	void decreaseKey(int id);
+
+	void updateKey(int id);
+
+	void remove(int id);
+
+	void clear();
+
+private:
+	void siftUp(int pos);
+
+	void siftDown(int pos);
+
+	void place(int pos, int id);
+};
+
+/// <summary>
+/// Create an empty heap
+/// </summary>
+/// <param name="capacity">one more than the largest id that will be stored</param>
+/// <param name="compare">the ordering of the ids</param>
+template <typename Compare>
+IndexedHeap<Compare>::IndexedHeap(int capacity, Compare compare)
+	: compare(compare)
+{
+	setCapacity(capacity);
+}
+
+/// <summary>
+/// Change the range of ids this heap can hold. The heap is emptied.
+/// </summary>
+/// <param name="capacity">one more than the largest id that will be stored</param>
+template <typename Compare>
+void IndexedHeap<Compare>::setCapacity(int capacity)
+{
+	heap.clear();
+	heap.reserve(capacity);
+	positions.assign(capacity, -1);
+}
+
+/// <summary>
+/// Replace the ordering of the ids. Only valid while the heap is empty.
+/// </summary>
+/// <param name="compare">the new ordering of the ids</param>
+template <typename Compare>
+void IndexedHeap<Compare>::setCompare(Compare compare)
+{
+	this->compare = compare;
+}
+
+/// <summary>
+/// Check if the heap is empty
+/// </summary>
+/// <returns>true if there are no ids in the heap and false otherwise</returns>
+template <typename Compare>
+bool IndexedHeap<Compare>::isEmpty()
+{
+	return heap.empty();
+}
+
+/// <summary>
+/// Get the number of ids in the heap
+/// </summary>
+/// <returns>the number of ids in the heap</returns>
+template <typename Compare>
+int IndexedHeap<Compare>::size()
+{
+	return (int)heap.size();
+}
+
+/// <summary>
+/// Check if the given id is in the heap
+/// </summary>
+/// <param name="id">the id to look for</param>
+/// <returns>true if the id is in the heap and false otherwise</returns>
+template <typename Compare>
+bool IndexedHeap<Compare>::contains(int id)
+{
+	return positions[id] != -1;
+}
+
+/// <summary>
+/// Add an id to the heap. The id must not already be in the heap.
+/// </summary>
+/// <param name="id">the id to add</param>
+template <typename Compare>
+void IndexedHeap<Compare>::push(int id)
+{
+	heap.push_back(id);
+	positions[id] = (int)heap.size() - 1;
+	siftUp((int)heap.size() - 1);
+}
+
+/// <summary>
+/// Get the id that would be popped next without removing it
+/// </summary>
+/// <returns>the id at the top of the heap</returns>
+template <typename Compare>
+int IndexedHeap<Compare>::top()
+{
+	return heap[0];
+}
+
+/// <summary>
+/// Remove the id at the top of the heap
+/// </summary>
+/// <returns>the id that was removed</returns>
+template <typename Compare>
+int IndexedHeap<Compare>::pop()
+{
+	int topId = heap[0];
+	int lastId = heap.back();
+	heap.pop_back();
+	positions[topId] = -1;
+
+	// move the last id to the top and restore the heap order
+	if (!heap.empty())
+	{
+		place(0, lastId);
+		siftDown(0);
+	}
+
+	return topId;
+}
+
+/// <summary>
+/// Restore the heap order after the key of the given id got smaller
+/// </summary>
+/// <param name="id">an id in the heap whose key decreased</param>
+template <typename Compare>
+void IndexedHeap<Compare>::decreaseKey(int id)
+{
+	siftUp(positions[id]);
+}
+
+/// <summary>
+/// Restore the heap order after the key of the given id changed either way
+/// </summary>
+/// <param name="id">an id in the heap whose key changed</param>
+template <typename Compare>
+void IndexedHeap<Compare>::updateKey(int id)
+{
+	siftUp(positions[id]);
+	siftDown(positions[id]);
+}
+
+/// <summary>
+/// Remove the given id from anywhere in the heap
+/// </summary>
+/// <param name="id">an id in the heap</param>
+template <typename Compare>
+void IndexedHeap<Compare>::remove(int id)
+{
+	int pos = positions[id];
+	int lastId = heap.back();
+	heap.pop_back();
+	positions[id] = -1;
+
+	// fill the hole with the last id, which may have to move either way
+	if (pos < (int)heap.size())
+	{
+		place(pos, lastId);
+		updateKey(lastId);
+	}
+}
+
+/// <summary>
+/// Remove every id from the heap. Only the ids still in the heap are
+/// touched so this is cheap after a search that emptied most of it.
+/// </summary>
+template <typename Compare>
+void IndexedHeap<Compare>::clear()
+{
+	for (int i = 0; i < (int)heap.size(); i++)
+	{
+		positions[heap[i]] = -1;
+	}
+	heap.clear();
+}
+
+/// <summary>
+/// Move the id at the given position up until its parent comes before it
+/// </summary>
+/// <param name="pos">a position in the heap</param>
+template <typename Compare>
+void IndexedHeap<Compare>::siftUp(int pos)
+{
+	int id = heap[pos];
+	while (pos > 0)
+	{
+		int parentPos = (pos - 1) / 2;
+		if (!compare(id, heap[parentPos]))
+		{
+			break;
+		}
+		place(pos, heap[parentPos]);
+		pos = parentPos;
+	}
+	place(pos, id);
+}
+
+/// <summary>
+/// Move the id at the given position down until it comes before its children
+/// </summary>
+/// <param name="pos">a position in the heap</param>
+template <typename Compare>
+void IndexedHeap<Compare>::siftDown(int pos)
+{
+	int id = heap[pos];
+	int count = (int)heap.size();
+	while (true)
+	{
+		int childPos = 2 * pos + 1;
+		if (childPos >= count)
+		{
+			break;
+		}
+		// pick the child that comes first
+		if (childPos + 1 < count && compare(heap[childPos + 1], heap[childPos]))
+		{
+			childPos++;
+		}
+		if (!compare(heap[childPos], id))
+		{
+			break;
+		}
+		place(pos, heap[childPos]);
+		pos = childPos;
+	}
+	place(pos, id);
+}
+
+/// <summary>
+/// Store an id at the given heap position and remember where it is
+/// </summary>
+/// <param name="pos">a position in the heap</param>
+/// <param name="id">the id to store</param>
+template <typename Compare>
+void IndexedHeap<Compare>::place(int pos, int id)
+{
+	heap[pos] = id;
+	positions[id] = pos;
+}
+
+#endif
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <SFML/Graphics.hpp>
 #include "PathFinder.hpp"
+#include "AsyncPathFinder.hpp"
+#include "GridRenderer.hpp"
 #include "Button.hpp"
 #include <Windows.h>
 
@@ -14,6 +16,14 @@ const int GRID_SIZE = 25;
 
 RenderWindow *window;
 PathFinder *pathFinder;
+// searches on a worker thread so frames never wait for a path
+AsyncPathFinder *asyncPathFinder;
+// the newest query, NULL before the first one
+shared_ptr<AsyncPathFinder::Request> pathRequest;
+// draws the grid and the path, updating only the cells that change
+GridRenderer *renderer;
+// the newest path found, shown until a newer one is found
+vector<Vector2i> path;
 Grid<PathFinder::GridNode>* grid;
 bool includeDiagonals = true;
 
@@ -45,6 +55,43 @@ void playerCursor()
 	}	
 }
 
+/// <summary>
+/// Draw the newest shortest path found between the start and destination
+/// cells, and ask for a new one if the grid or the query changed
+/// </summary>
+/// <returns>true if there are start and destination cells and false otherwise</returns>
+bool drawPath()
+{
+	Vector2i* startPos = pathFinder->getStartPos();
+	Vector2i* endPos = pathFinder->getEndPos();
+	if (startPos == NULL || endPos == NULL)
+	{
+		return false;
+	}
+
+	// the newest query is stale once the endpoints, the diagonal mode or
+	// the grid changed, edits to the grid cancel it themselves
+	if (pathRequest == NULL || pathRequest->isCancelled()
+		|| pathRequest->getStart() != *startPos || pathRequest->getEnd() != *endPos
+		|| pathRequest->getIncludeDiagonals() != includeDiagonals
+		|| pathRequest->getRevision() != pathFinder->getRevision())
+	{
+		if (pathRequest != NULL)
+		{
+			pathRequest->cancel();
+		}
+		pathRequest = asyncPathFinder->findPathAsync(*startPos, *endPos, includeDiagonals);
+	}
+
+	// keep showing the previous path until the new one is done
+	if (pathRequest->isDone() && pathRequest->getStatus() != PathFinder::PathStatus::CANCELLED)
+	{
+		path = *pathRequest->getPath();
+	}
+	renderer->setPath(&path);
+	return true;
+}
+
 /// <summary>
 /// Handle the player's ability to color the grid
 /// </summary>
@@ -57,7 +104,14 @@ void playerController()
 	if (Mouse::isButtonPressed(Mouse::Button::Left))
 	{
 		// pressed left mouse button
-		if (Keyboard::isKeyPressed(Keyboard::Key::LShift))
+		if (Keyboard::isKeyPressed(Keyboard::Key::LControl))
+		{
+			// paint rough terrain, or plain ground with shift
+			Vector2i gridPos = grid->screenToGrid(mousePos);
+			int terrainCost = Keyboard::isKeyPressed(Keyboard::Key::LShift) ? MIN_TERRAIN_COST : MAX_TERRAIN_COST;
+			pathFinder->setTerrainCostAt(gridPos.x, gridPos.y, terrainCost);
+		}
+		else if (Keyboard::isKeyPressed(Keyboard::Key::LShift))
 		{
 			// unoccupy cell
 			pathFinder->setValAt(mousePos, GridValue::UNOCCUPIED);
@@ -82,7 +136,7 @@ void playerController()
 	}
 	else if (Keyboard::isKeyPressed(Keyboard::Key::Tab))
 	{
-		if (!pathFinder->drawShortestPath(window, includeDiagonals))
+		if (!drawPath())
 		{
 			cout << "missing start/end" << endl;
 		}
@@ -109,7 +163,7 @@ void UILogic()
 	if (pathButton->isButtonPressed(window))
 	{
 		// draw shortest path if the button is being pressed
-		pathFinder->drawShortestPath(window, includeDiagonals);
+		drawPath();
 	}
 
 	// check to see if the diagonal toggle button is being pressed
@@ -140,7 +194,11 @@ int main()
 			VideoMode(WINDOW_WIDTH, WINDOW_HEIGHT + EXTRA_UI_HEIGHT), "Pathfinding", Style::Close);
 	// instantiate grid
 	pathFinder = new PathFinder(WINDOW_WIDTH / GRID_SIZE, WINDOW_HEIGHT / GRID_SIZE, GRID_SIZE);	
+	// paths go around rough terrain when that is cheaper
+	pathFinder->setSearchEngine(PathFinder::SearchEngine::WEIGHTED);
 	grid = pathFinder->getGrid();
+	asyncPathFinder = new AsyncPathFinder(pathFinder);
+	renderer = new GridRenderer(pathFinder);
 
 	// make buttons
 	// size of all buttons
@@ -176,11 +234,13 @@ int main()
 		window->clear();
 
 		// logic
+		// the path only shows while it is asked for
+		renderer->clearPath();
 		playerController();
 		UILogic();
 		
 		// draw objects
-		pathFinder->drawGrid(window);
+		renderer->draw(window);
 		playerCursor();
 		drawUI();
 
@@ -188,6 +248,14 @@ int main()
 		window->display();
 	}
 
+	// summarize the work of every path query, for runs with the console shown
+	SearchStatistics statistics;
+	asyncPathFinder->getStatistics(&statistics);
+	statistics.print(cout);
+
+	delete(renderer);
+	pathRequest = NULL;
+	delete(asyncPathFinder);
 	delete(pathFinder);
 	delete(window);
 	delete(pathButton);
@@ -0,0 +1,236 @@
+#ifndef MOVING_AI_MAP_H
+#define MOVING_AI_MAP_H
+
+#include "PathFinder.hpp"
+#include "OccupancyGrid.hpp"
+#include "GridFile.hpp"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+using namespace sf;
+
+/// <summary>
+/// A grid map in the text format of the MovingAI pathfinding benchmarks:
+///
+///   type octile
+///   height 4
+///   width 5
+///   map
+///   .....
+///   .@@T.
+///   ...
+///
+/// '.', 'G' and 'S' are passable, every other character is occupied.
+/// </summary>
+class MovingAiMap
+{
+public:
+	// one query of a MovingAI .scen file
+	struct Scenario
+	{
+		int bucket;
+		Vector2i start;
+		Vector2i end;
+		double optimalLength; // octile length of a shortest path that doesn't cut corners
+	};
+
+private:
+	int width;
+	int height;
+	vector<unsigned char> passable; // one per cell, row-major
+
+public:
+	MovingAiMap();
+
+	bool load(const string &fileName);
+
+	int getWidth();
+
+	int getHeight();
+
+	bool isPassable(int x, int y);
+
+	PathFinder *createPathFinder(int cellSize);
+
+	bool saveGridFile(const string &fileName);
+
+	static bool loadScenarios(const string &fileName, vector<Scenario> *scenarios);
+};
+
+/// <summary>
+/// Create an empty map
+/// </summary>
+MovingAiMap::MovingAiMap()
+{
+	width = 0;
+	height = 0;
+}
+
+/// <summary>
+/// Read a map from a .map file
+/// </summary>
+/// <param name="fileName">the path of the file</param>
+/// <returns>true if the file was read and false if it is missing or malformed</returns>
+bool MovingAiMap::load(const string &fileName)
+{
+	ifstream file(fileName);
+	if (!file)
+	{
+		return false;
+	}
+
+	// header lines come in any order until "map"
+	width = 0;
+	height = 0;
+	string word;
+	while (file >> word && word != "map")
+	{
+		if (word == "height")
+		{
+			file >> height;
+		}
+		else if (word == "width")
+		{
+			file >> width;
+		}
+		else if (word == "type")
+		{
+			file >> word;
+		}
+	}
+	if (word != "map" || width <= 0 || height <= 0)
+	{
+		return false;
+	}
+
+	passable.assign(width * height, 0);
+	for (int y = 0; y < height; y++)
+	{
+		string row;
+		if (!(file >> row) || (int)row.size() < width)
+		{
+			return false;
+		}
+		for (int x = 0; x < width; x++)
+		{
+			char c = row[x];
+			passable[y * width + x] = (c == '.' || c == 'G' || c == 'S') ? 1 : 0;
+		}
+	}
+
+	return true;
+}
+
+/// <summary>
+/// Get the width of the map
+/// </summary>
+/// <returns>the width of the map in cells</returns>
+int MovingAiMap::getWidth()
+{
+	return width;
+}
+
+/// <summary>
+/// Get the height of the map
+/// </summary>
+/// <returns>the height of the map in cells</returns>
+int MovingAiMap::getHeight()
+{
+	return height;
+}
+
+/// <summary>
+/// Check if a cell of the map is passable
+/// </summary>
+/// <param name="x">the x coordinate of a cell</param>
+/// <param name="y">the y coordinate of a cell</param>
+/// <returns>true if the cell is passable and false otherwise</returns>
+bool MovingAiMap::isPassable(int x, int y)
+{
+	return passable[y * width + x] != 0;
+}
+
+/// <summary>
+/// Make a PathFinder whose grid has the map's occupied cells
+/// </summary>
+/// <param name="cellSize">the size of each grid cell on screen</param>
+/// <returns>a new PathFinder owned by the caller</returns>
+PathFinder *MovingAiMap::createPathFinder(int cellSize)
+{
+	PathFinder* pathFinder = new PathFinder(width, height, cellSize);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			if (!isPassable(x, y))
+			{
+				pathFinder->setValAt(x, y, GridValue::OCCUPIED);
+			}
+		}
+	}
+	return pathFinder;
+}
+
+/// <summary>
+/// Convert the map to a binary grid file that can be mapped by GridFile
+/// </summary>
+/// <param name="fileName">the path of the grid file to write</param>
+/// <returns>true if the file was written and false otherwise</returns>
+bool MovingAiMap::saveGridFile(const string &fileName)
+{
+	OccupancyGrid occupancy(width, height);
+	for (int id = 0; id < width * height; id++)
+	{
+		if (!passable[id])
+		{
+			occupancy.setOccupied(id, true);
+		}
+	}
+	return GridFile::save(fileName, &occupancy);
+}
+
+/// <summary>
+/// Read the queries of a .scen file. Each line after the version line is
+/// "bucket map width height startX startY endX endY optimalLength".
+/// </summary>
+/// <param name="fileName">the path of the file</param>
+/// <param name="scenarios">filled with the queries of the file</param>
+/// <returns>true if the file was read and false if it is missing or malformed</returns>
+bool MovingAiMap::loadScenarios(const string &fileName, vector<Scenario> *scenarios)
+{
+	ifstream file(fileName);
+	if (!file)
+	{
+		return false;
+	}
+
+	scenarios->clear();
+	string line;
+	while (getline(file, line))
+	{
+		if (line.empty() || line.compare(0, 7, "version") == 0)
+		{
+			continue;
+		}
+
+		istringstream fields(line);
+		Scenario scenario;
+		string mapName;
+		int mapWidth;
+		int mapHeight;
+		if (!(fields >> scenario.bucket >> mapName >> mapWidth >> mapHeight
+			>> scenario.start.x >> scenario.start.y >> scenario.end.x >> scenario.end.y
+			>> scenario.optimalLength))
+		{
+			return false;
+		}
+		scenarios->push_back(scenario);
+	}
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef NEIGHBOURS_H
+#define NEIGHBOURS_H
+
+#include "OccupancyGrid.hpp"
+
+// offsets of the 8 neighbours of a cell, in the bit order of
+// OccupancyGrid::getPassableNeighbours, row by row from the top left:
+//   0 1 2
+//   3 . 4
+//   5 6 7
+const int NEIGHBOUR_X_OFFSETS[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+const int NEIGHBOUR_Y_OFFSETS[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+// the neighbour bits column by column from the top left, the order the
+// neighbours of a cell used to be listed in. A* reaches neighbours in this
+// order, since it decides which of several equally short paths is found.
+const int NEIGHBOUR_SCAN_ORDER[8] = { 0, 3, 5, 1, 6, 2, 4, 7 };
+// whether each neighbour is a diagonal move away
+const bool NEIGHBOUR_IS_DIAGONAL[8] = { true, false, true, false, false, true, false, true };
+
+/// <summary>
+/// Paths move up, down, left and right only
+/// </summary>
+struct FourConnected
+{
+	static const int NUM_OF_NEIGHBOURS = 4;
+	// bits of the straight neighbours
+	static const int DIRECTIONS = 0x5A;
+	static const bool HAS_DIAGONALS = false;
+};
+
+/// <summary>
+/// Paths also move diagonally
+/// </summary>
+struct EightConnected
+{
+	static const int NUM_OF_NEIGHBOURS = 8;
+	static const int DIRECTIONS = 0xFF;
+	static const bool HAS_DIAGONALS = true;
+};
+
+/// <summary>
+/// Get the neighbour bits a path can move to
+/// </summary>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <returns>the mask of neighbour bits</returns>
+inline int neighbourDirections(bool includeDiagonals)
+{
+	return includeDiagonals ? EightConnected::DIRECTIONS : FourConnected::DIRECTIONS;
+}
+
+/// <summary>
+/// Get the neighbour bit of a cell next to another one
+/// </summary>
+/// <param name="dx">the x offset of the neighbour, -1, 0 or 1</param>
+/// <param name="dy">the y offset of the neighbour, -1, 0 or 1, not both 0</param>
+/// <returns>the index of the neighbour's bit</returns>
+inline int neighbourIndex(int dx, int dy)
+{
+	int index = (dy + 1) * 3 + dx + 1;
+	// the cell itself has no bit
+	return index < 4 ? index : index - 1;
+}
+
+/// <summary>
+/// Take the lowest neighbour bit out of a mask
+/// </summary>
+/// <param name="mask">a mask of neighbour bits, not 0</param>
+/// <returns>the index of the bit that was taken out</returns>
+inline int popNeighbour(int *mask)
+{
+	int index = OccupancyGrid::lowestBit((uint64_t)*mask);
+	*mask &= *mask - 1;
+	return index;
+}
+
+#endif
@@ -0,0 +1,283 @@
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+/// <summary>
+/// One bit per cell saying whether the cell is occupied. The bits are
+/// packed in cell id order (row-major, id = y * width + x) into 64-bit
+/// words, lowest bit first, so the bit of a cell is found with a shift and
+/// a mask. Bits past the last cell are 0.
+///
+/// The words are either owned by the grid or belong to someone else,
+/// like a mapped grid file, in which case the grid reads and writes them
+/// in place.
+///
+/// Runs of up to 64 cells of a row can be read as one word, which lets
+/// searches test a whole neighbourhood or scan along a row with a few
+/// word operations instead of one test per cell.
+/// </summary>
+class OccupancyGrid
+{
+private:
+	int width;
+	int height;
+	int wordCount;
+	uint64_t *words; // the bits, either ownedWords or external memory
+	vector<uint64_t> ownedWords;
+
+public:
+	OccupancyGrid(int width, int height);
+
+	OccupancyGrid(int width, int height, uint64_t *externalWords);
+
+	int getWidth();
+
+	int getHeight();
+
+	int getWordCount();
+
+	static int wordsFor(int cellCount);
+
+	uint64_t *getWords();
+
+	bool isOccupied(int id);
+
+	void setOccupied(int id, bool occupied);
+
+	uint64_t getBits(int id, int count);
+
+	uint64_t getRowBits(int x, int y, int count);
+
+	int getPassableNeighbours(int x, int y);
+
+	static uint64_t lowBitsMask(int count);
+
+	static int lowestBit(uint64_t bits);
+
+	static int highestBit(uint64_t bits);
+
+private:
+	// a copy would share or lose the external words
+	OccupancyGrid(const OccupancyGrid &other) = delete;
+
+	OccupancyGrid &operator = (const OccupancyGrid &other) = delete;
+};
+
+/// <summary>
+/// Create a grid with every cell passable
+/// </summary>
+/// <param name="width">the width of the grid</param>
+/// <param name="height">the height of the grid</param>
+OccupancyGrid::OccupancyGrid(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+	wordCount = wordsFor(width * height);
+	ownedWords.assign(wordCount, 0);
+	words = ownedWords.data();
+}
+
+/// <summary>
+/// Create a grid over bits stored somewhere else. The words must stay
+/// valid for the life of the grid.
+/// </summary>
+/// <param name="width">the width of the grid</param>
+/// <param name="height">the height of the grid</param>
+/// <param name="externalWords">wordsFor(width * height) words of bits</param>
+OccupancyGrid::OccupancyGrid(int width, int height, uint64_t *externalWords)
+{
+	this->width = width;
+	this->height = height;
+	wordCount = wordsFor(width * height);
+	words = externalWords;
+}
+
+/// <summary>
+/// Get the width of the grid
+/// </summary>
+/// <returns>the width of the grid</returns>
+int OccupancyGrid::getWidth()
+{
+	return width;
+}
+
+/// <summary>
+/// Get the height of the grid
+/// </summary>
+/// <returns>the height of the grid</returns>
+int OccupancyGrid::getHeight()
+{
+	return height;
+}
+
+/// <summary>
+/// Get the number of words holding the bits
+/// </summary>
+/// <returns>the number of 64-bit words</returns>
+int OccupancyGrid::getWordCount()
+{
+	return wordCount;
+}
+
+/// <summary>
+/// Get the number of words needed for the bits of the given number of cells
+/// </summary>
+/// <param name="cellCount">the number of cells</param>
+/// <returns>the number of 64-bit words</returns>
+int OccupancyGrid::wordsFor(int cellCount)
+{
+	return (cellCount + 63) / 64;
+}
+
+/// <summary>
+/// Get the words holding the bits
+/// </summary>
+/// <returns>the first word</returns>
+uint64_t *OccupancyGrid::getWords()
+{
+	return words;
+}
+
+/// <summary>
+/// Check if a cell is occupied
+/// </summary>
+/// <param name="id">the id of a cell</param>
+/// <returns>true if the cell is occupied and false otherwise</returns>
+bool OccupancyGrid::isOccupied(int id)
+{
+	return (words[id >> 6] >> (id & 63)) & 1;
+}
+
+/// <summary>
+/// Set whether a cell is occupied
+/// </summary>
+/// <param name="id">the id of a cell</param>
+/// <param name="occupied">whether the cell is occupied</param>
+void OccupancyGrid::setOccupied(int id, bool occupied)
+{
+	uint64_t mask = (uint64_t)1 << (id & 63);
+	if (occupied)
+	{
+		words[id >> 6] |= mask;
+	}
+	else
+	{
+		words[id >> 6] &= ~mask;
+	}
+}
+
+/// <summary>
+/// Read the bits of consecutive cells, which must all be in the grid
+/// </summary>
+/// <param name="id">the id of the first cell</param>
+/// <param name="count">the number of cells, from 1 to 64</param>
+/// <returns>the bits of the cells, the first cell in the lowest bit</returns>
+uint64_t OccupancyGrid::getBits(int id, int count)
+{
+	int word = id >> 6;
+	int offset = id & 63;
+	uint64_t bits = words[word] >> offset;
+	// the run goes on in the next word
+	if (offset != 0 && offset + count > 64)
+	{
+		bits |= words[word + 1] << (64 - offset);
+	}
+	return bits & lowBitsMask(count);
+}
+
+/// <summary>
+/// Read the bits of a run of cells in one row. Cells outside of the grid
+/// read as occupied, so scans stop at the edges.
+/// </summary>
+/// <param name="x">the x coordinate of the first cell, can be outside of the grid</param>
+/// <param name="y">the y coordinate of the row, can be outside of the grid</param>
+/// <param name="count">the number of cells, from 1 to 64</param>
+/// <returns>the bits of the cells, the first cell in the lowest bit</returns>
+uint64_t OccupancyGrid::getRowBits(int x, int y, int count)
+{
+	uint64_t allOccupied = lowBitsMask(count);
+	int first = max(x, 0);
+	int last = min(x + count, width);
+	if (y < 0 || y >= height || first >= last)
+	{
+		return allOccupied;
+	}
+
+	int shift = first - x;
+	uint64_t inside = lowBitsMask(last - first) << shift;
+	return (getBits(y * width + first, last - first) << shift) | (allOccupied & ~inside);
+}
+
+/// <summary>
+/// Find which of the 8 cells around a cell are in the grid and passable,
+/// with three word reads instead of eight cell tests. Bit i of the mask is
+/// set if the i-th neighbour is passable, counting row by row from the top
+/// left and skipping the cell itself:
+///   0 1 2
+///   3 . 4
+///   5 6 7
+/// </summary>
+/// <param name="x">the x coordinate of a cell</param>
+/// <param name="y">the y coordinate of a cell</param>
+/// <returns>the mask of passable neighbours</returns>
+int OccupancyGrid::getPassableNeighbours(int x, int y)
+{
+	int above = (int)(~getRowBits(x - 1, y - 1, 3) & 7);
+	int middle = (int)(~getRowBits(x - 1, y, 3) & 5);
+	int below = (int)(~getRowBits(x - 1, y + 1, 3) & 7);
+	// drop the middle cell's bit by moving the right neighbour down one
+	return above | ((middle & 1) << 3) | ((middle & 4) << 2) | (below << 5);
+}
+
+/// <summary>
+/// Get a word with the given number of low bits set
+/// </summary>
+/// <param name="count">the number of bits, from 0 to 64</param>
+/// <returns>the mask</returns>
+uint64_t OccupancyGrid::lowBitsMask(int count)
+{
+	return count >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << count) - 1;
+}
+
+/// <summary>
+/// Find the lowest set bit of a word
+/// </summary>
+/// <param name="bits">a word with at least one bit set</param>
+/// <returns>the index of the lowest set bit</returns>
+int OccupancyGrid::lowestBit(uint64_t bits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, bits);
+	return (int)index;
+#else
+	return __builtin_ctzll(bits);
+#endif
+}
+
+/// <summary>
+/// Find the highest set bit of a word
+/// </summary>
+/// <param name="bits">a word with at least one bit set</param>
+/// <returns>the index of the highest set bit</returns>
+int OccupancyGrid::highestBit(uint64_t bits)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, bits);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(bits);
+#endif
+}
+
+#endif
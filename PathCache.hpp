@@ -0,0 +1,436 @@
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+#include "PathFinder.hpp"
+#include "GridChangeListener.hpp"
+#include "SearchContext.hpp"
+#include <vector>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <algorithm>
+
+using namespace std;
+using namespace sf;
+
+/// <summary>
+/// A least recently used cache of the paths found by a PathFinder, keyed
+/// on the start, the end, the diagonal mode, the search engine and the
+/// heuristic, and checked against the grid revision.
+///
+/// By default a cached path is only used at the revision it was found at,
+/// so any change to the grid's passability makes every cached path miss.
+/// With region invalidation on, the cache also remembers the recent edits
+/// and a path found at an older revision is kept if none of the edits since
+/// then could change it: a newly occupied cell only matters if it is on the
+/// path, and a newly passable cell only matters if a path through it could
+/// be shorter than the cached one, which the octile distance rules out for
+/// cells far enough from the path. Paths found with a heuristic that
+/// overestimates aren't shortest paths to begin with, so they are only
+/// used at the revision they were found at.
+/// </summary>
+class PathCache : public GridChangeListener
+{
+private:
+	// a cell that changed between occupied and passable
+	struct CellEdit
+	{
+		unsigned long long revision; // revision of the grid after the edit
+		int id;
+		bool blocked; // whether the cell became occupied
+	};
+
+	// a cached query and its result
+	struct CacheEntry
+	{
+		unsigned long long key;
+		unsigned long long revision; // revision at which the result is known to hold
+		PathFinder::PathStatus status;
+		int cost; // cost of the path if one was found
+		vector<Vector2i> path;
+		// bounding box of the path and its start
+		int left;
+		int top;
+		int right;
+		int bottom;
+	};
+
+	// edits older than this many are forgotten and the paths before them dropped
+	static const int MAX_LOGGED_EDITS = 4096;
+	// number of values of PathFinder::SearchEngine and PathFinder::Heuristic
+	static const int SEARCH_ENGINE_COUNT = 3;
+	static const int HEURISTIC_COUNT = 4;
+
+	PathFinder *pathFinder;
+	int capacity; // the most paths kept at once
+	bool regionInvalidation;
+	SearchContext *searchContext; // for the queries that miss
+
+	list<CacheEntry> entries; // most recently used first
+	unordered_map<unsigned long long, list<CacheEntry>::iterator> entryByKey;
+
+	deque<CellEdit> edits; // edits since oldestKnownRevision, oldest first
+	unsigned long long oldestKnownRevision; // revision before the oldest logged edit
+
+	int hitCount;
+	int missCount;
+
+public:
+	PathCache(PathFinder *pathFinder, int capacity, bool regionInvalidation);
+
+	~PathCache();
+
+	PathFinder::PathStatus findPath(Vector2i start, Vector2i end, bool includeDiagonals, vector<Vector2i> *path);
+
+	void onCellChanged(int x, int y, GridValue oldVal, GridValue newVal) override;
+
+	void onTerrainChanged(int x, int y, int oldCost, int newCost) override;
+
+	void clear();
+
+	int getSize();
+
+	int getHitCount();
+
+	int getMissCount();
+
+private:
+	unsigned long long makeKey(int startId, int endId, bool includeDiagonals);
+
+	bool isStillValid(CacheEntry *entry, Vector2i start, Vector2i end, bool includeDiagonals);
+
+	bool isOnPath(CacheEntry *entry, Vector2i pos);
+
+	void insert(unsigned long long key, PathFinder::PathStatus status, Vector2i start,
+		const vector<Vector2i> *path);
+
+	void fillEntry(CacheEntry *entry, PathFinder::PathStatus status, Vector2i start,
+		const vector<Vector2i> *path);
+
+	PathCache(const PathCache &other) = delete;
+
+	PathCache &operator = (const PathCache &other) = delete;
+};
+
+/// <summary>
+/// Create an empty cache for the paths of the given PathFinder and start
+/// listening for changes to its grid
+/// </summary>
+/// <param name="pathFinder">the path finder whose paths are cached</param>
+/// <param name="capacity">the most paths kept at once</param>
+/// <param name="regionInvalidation">whether paths from older revisions are
+/// kept when the edits since then can't have changed them</param>
+PathCache::PathCache(PathFinder *pathFinder, int capacity, bool regionInvalidation)
+{
+	this->pathFinder = pathFinder;
+	this->capacity = max(1, capacity);
+	this->regionInvalidation = regionInvalidation;
+	searchContext = new SearchContext();
+	oldestKnownRevision = pathFinder->getRevision();
+	hitCount = 0;
+	missCount = 0;
+
+	pathFinder->addChangeListener(this);
+}
+
+/// <summary>
+/// Stop listening for changes and free the search state
+/// </summary>
+PathCache::~PathCache()
+{
+	pathFinder->removeChangeListener(this);
+	delete(searchContext);
+}
+
+/// <summary>
+/// Log a cell that changed between occupied and passable
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+/// <param name="oldVal">the value the cell had before</param>
+/// <param name="newVal">the value the cell has now</param>
+void PathCache::onCellChanged(int x, int y, GridValue oldVal, GridValue newVal)
+{
+	if (!regionInvalidation || (oldVal == GridValue::OCCUPIED) == (newVal == GridValue::OCCUPIED))
+	{
+		return;
+	}
+
+	CellEdit edit;
+	edit.revision = pathFinder->getRevision();
+	edit.id = pathFinder->getGrid()->toIndex(x, y);
+	edit.blocked = newVal == GridValue::OCCUPIED;
+	edits.push_back(edit);
+
+	if (edits.size() > MAX_LOGGED_EDITS)
+	{
+		oldestKnownRevision = edits.front().revision;
+		edits.pop_front();
+	}
+}
+
+/// <summary>
+/// Forget the logged edits, so every path found before a terrain change
+/// misses. The edit log only rules paths out by passability, and a change
+/// of terrain cost can make a path dearer without blocking it.
+/// </summary>
+/// <param name="x">the x coordinate of the cell</param>
+/// <param name="y">the y coordinate of the cell</param>
+/// <param name="oldCost">the terrain cost the cell had before</param>
+/// <param name="newCost">the terrain cost the cell has now</param>
+void PathCache::onTerrainChanged(int /*x*/, int /*y*/, int /*oldCost*/, int /*newCost*/)
+{
+	edits.clear();
+	oldestKnownRevision = pathFinder->getRevision();
+}
+
+/// <summary>
+/// Drop every cached path
+/// </summary>
+void PathCache::clear()
+{
+	entries.clear();
+	entryByKey.clear();
+}
+
+/// <summary>
+/// Get the number of cached paths
+/// </summary>
+/// <returns>the number of cached paths</returns>
+int PathCache::getSize()
+{
+	return (int)entries.size();
+}
+
+/// <summary>
+/// Get the number of queries answered from the cache
+/// </summary>
+/// <returns>the number of cache hits</returns>
+int PathCache::getHitCount()
+{
+	return hitCount;
+}
+
+/// <summary>
+/// Get the number of queries that had to search
+/// </summary>
+/// <returns>the number of cache misses</returns>
+int PathCache::getMissCount()
+{
+	return missCount;
+}
+
+/// <summary>
+/// Find the shortest path between two grid positions, from the cache if
+/// it holds a path for them that is still a shortest path
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="path">filled with the grid positions of the path starting
+/// after the start and ending with the end if a path is found</param>
+/// <returns>whether a path was found</returns>
+PathFinder::PathStatus PathCache::findPath(Vector2i start, Vector2i end, bool includeDiagonals,
+	vector<Vector2i> *path)
+{
+	Grid<PathFinder::GridNode>* grid = pathFinder->getGrid();
+	if (!grid->validCoords(start.x, start.y) || !grid->validCoords(end.x, end.y))
+	{
+		return PathFinder::PathStatus::INVALID_ENDPOINTS;
+	}
+
+	unsigned long long key = makeKey(grid->toIndex(start.x, start.y), grid->toIndex(end.x, end.y),
+		includeDiagonals);
+	auto found = entryByKey.find(key);
+	if (found != entryByKey.end())
+	{
+		CacheEntry* entry = &*found->second;
+		if (isStillValid(entry, start, end, includeDiagonals))
+		{
+			// move it to the front of the list
+			entries.splice(entries.begin(), entries, found->second);
+			hitCount++;
+			*path = entry->path;
+			return entry->status;
+		}
+
+		// search again and keep the result in the same entry
+		entries.splice(entries.begin(), entries, found->second);
+		missCount++;
+		PathFinder::PathStatus status = pathFinder->findPath(start, end, includeDiagonals, searchContext, path);
+		fillEntry(entry, status, start, path);
+		return status;
+	}
+
+	missCount++;
+	PathFinder::PathStatus status = pathFinder->findPath(start, end, includeDiagonals, searchContext, path);
+	insert(key, status, start, path);
+	return status;
+}
+
+/// <summary>
+/// Combine a query and the current search engine and heuristic into one
+/// cache key, since the engine and heuristic decide which path is found
+/// and the engine decides what the path costs
+/// </summary>
+/// <param name="startId">the id of the start cell</param>
+/// <param name="endId">the id of the end cell</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <returns>the key of the query</returns>
+unsigned long long PathCache::makeKey(int startId, int endId, bool includeDiagonals)
+{
+	unsigned long long cellCount = (unsigned long long)pathFinder->getGrid()->getGridWidth()
+		* pathFinder->getGrid()->getGridHeight();
+	unsigned long long key = ((unsigned long long)startId * cellCount + endId) * 2 + (includeDiagonals ? 1 : 0);
+	key = key * SEARCH_ENGINE_COUNT + (int)pathFinder->getSearchEngine();
+	return key * HEURISTIC_COUNT + (int)pathFinder->getHeuristic();
+}
+
+/// <summary>
+/// Check if a cached result still holds at the current revision, and if
+/// so mark it as known to hold at the current revision
+/// </summary>
+/// <param name="entry">the cached result</param>
+/// <param name="start">the start of the query</param>
+/// <param name="end">the end of the query</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <returns>true if the result can be used and false otherwise</returns>
+bool PathCache::isStillValid(CacheEntry *entry, Vector2i start, Vector2i end, bool includeDiagonals)
+{
+	unsigned long long revision = pathFinder->getRevision();
+	if (entry->revision == revision)
+	{
+		return true;
+	}
+	if (!regionInvalidation || entry->revision < oldestKnownRevision)
+	{
+		return false;
+	}
+	// manhattan distances overestimate diagonal moves, so the cached path
+	// might not be a shortest one that the edits can be checked against
+	if (includeDiagonals && pathFinder->getHeuristic() == PathFinder::Heuristic::MANHATTAN)
+	{
+		return false;
+	}
+
+	Grid<PathFinder::GridNode>* grid = pathFinder->getGrid();
+	// skip the edits the entry has already been checked against,
+	// they are in revision order
+	auto firstEdit = lower_bound(edits.begin(), edits.end(), entry->revision + 1,
+		[](const CellEdit& edit, unsigned long long rev) { return edit.revision < rev; });
+	for (auto edit = firstEdit; edit != edits.end(); edit++)
+	{
+		Vector2i pos = grid->toCoords(edit->id);
+		if (entry->status != PathFinder::PathStatus::FOUND)
+		{
+			// blocking more cells can't connect the start and end
+			if (!edit->blocked)
+			{
+				return false;
+			}
+		}
+		else if (edit->blocked)
+		{
+			// a path that avoids the cell is still a shortest path
+			if (isOnPath(entry, pos))
+			{
+				return false;
+			}
+		}
+		else if (PathFinder::getDistance(start, pos) + PathFinder::getDistance(pos, end) < entry->cost)
+		{
+			// a path through the cell might be shorter
+			return false;
+		}
+	}
+
+	entry->revision = revision;
+	return true;
+}
+
+/// <summary>
+/// Check if a grid position is one of the cells of a cached path
+/// </summary>
+/// <param name="entry">a cached path</param>
+/// <param name="pos">a grid position</param>
+/// <returns>true if the path goes through the position and false otherwise</returns>
+bool PathCache::isOnPath(CacheEntry *entry, Vector2i pos)
+{
+	if (pos.x < entry->left || pos.x > entry->right || pos.y < entry->top || pos.y > entry->bottom)
+	{
+		return false;
+	}
+	return find(entry->path.begin(), entry->path.end(), pos) != entry->path.end();
+}
+
+/// <summary>
+/// Cache the result of a query, dropping the least recently used
+/// result if the cache is full
+/// </summary>
+/// <param name="key">the key of the query</param>
+/// <param name="status">whether a path was found</param>
+/// <param name="start">the start of the query</param>
+/// <param name="path">the path found</param>
+void PathCache::insert(unsigned long long key, PathFinder::PathStatus status, Vector2i start,
+	const vector<Vector2i> *path)
+{
+	if (status == PathFinder::PathStatus::INVALID_ENDPOINTS || status == PathFinder::PathStatus::CANCELLED)
+	{
+		return;
+	}
+
+	if ((int)entries.size() >= capacity)
+	{
+		// reuse the least recently used entry, its list and map nodes and
+		// the room of its path, so a full cache doesn't allocate on a miss
+		// unless the new path is longer
+		entries.splice(entries.begin(), entries, prev(entries.end()));
+		auto node = entryByKey.extract(entries.front().key);
+		node.key() = key;
+		entryByKey.insert(move(node));
+	}
+	else
+	{
+		entries.push_front(CacheEntry());
+		entryByKey[key] = entries.begin();
+	}
+
+	entries.front().key = key;
+	fillEntry(&entries.front(), status, start, path);
+}
+
+/// <summary>
+/// Store the result of a query in an entry
+/// </summary>
+/// <param name="entry">the entry of the query</param>
+/// <param name="status">whether a path was found</param>
+/// <param name="start">the start of the query</param>
+/// <param name="path">the path found</param>
+void PathCache::fillEntry(CacheEntry *entry, PathFinder::PathStatus status, Vector2i start,
+	const vector<Vector2i> *path)
+{
+	entry->revision = pathFinder->getRevision();
+	entry->status = status;
+	entry->cost = 0;
+	entry->left = entry->right = start.x;
+	entry->top = entry->bottom = start.y;
+	if (status == PathFinder::PathStatus::FOUND)
+	{
+		entry->path.assign(path->begin(), path->end());
+		entry->cost = pathFinder->getPathCost(start, path);
+		for (int i = 0; i < path->size(); i++)
+		{
+			Vector2i pos = (*path)[i];
+			entry->left = min(entry->left, pos.x);
+			entry->right = max(entry->right, pos.x);
+			entry->top = min(entry->top, pos.y);
+			entry->bottom = max(entry->bottom, pos.y);
+		}
+	}
+	else
+	{
+		entry->path.clear();
+	}
+}
+
+#endif
@@ -2,12 +2,27 @@
 #define PATH_FINDER_H
 
 #include <stdio.h>
+#include <iostream>
 #include "SFML/Graphics.hpp"
 #include "Grid.hpp"
 #include "GridCellStates.hpp"
+#include "SearchContext.hpp"
+#include "ThreadPool.hpp"
+#include "GridChangeListener.hpp"
+#include "OccupancyGrid.hpp"
+#include "GridFile.hpp"
+#include "Neighbours.hpp"
+#include "ClearanceMap.hpp"
+#include "ComponentMap.hpp"
+#include "SearchPolicies.hpp"
+#include "SearchStatistics.hpp"
 #include <vector>
-#include <unordered_set>
 #include <algorithm>
+#include <climits>
+#include <cmath>
+#include <chrono>
+#include <mutex>
+#include <atomic>
 
 using namespace std;
 using namespace sf;
@@ -23,14 +38,6 @@ public:
 	{
 		GridValue val; // value of this node
 		Vector2i gridPos; // position of this node in the grid
-		GridNode *parentNode; // node that came before this node in the path
-		int gCost; // distance from starting node
-		int hCost; // distance from end node
-
-		int fCost()
-		{
-			return gCost + hCost;
-		}
 
 		// override equals operator
 		bool operator == (const GridNode& other) const
@@ -45,66 +52,339 @@ public:
 		}
 	};
 
-	// custom hashing for GridNodes
-	struct NodeHash
+	// outcome of a path query
+	enum class PathStatus
 	{
-		size_t operator() (const GridNode* node) const
-		{
-			return node->gCost + node->hCost + (int)node->val;
-		}
+		FOUND, // a path was found
+		UNREACHABLE, // the end can't be reached from the start
+		INVALID_ENDPOINTS, // the start or end is outside of the grid
+		CANCELLED, // the search was stopped through its context's cancel flag
+		IN_PROGRESS // a sliced search used up its budget and can be stepped again
+	};
+
+	// algorithm used to answer path queries
+	enum class SearchEngine
+	{
+		A_STAR, // plain A* over every cell
+		JUMP_POINT, // A* over jump points only, for grids with uniform move costs
+		WEIGHTED // A* over every cell with terrain costs, ordered by a bucket queue
+	};
+
+	// estimate of the cost left to the end used by A*
+	enum class Heuristic
+	{
+		OCTILE, // exact on open grids with diagonals, the default
+		MANHATTAN, // exact on open grids without diagonals, overestimates with them
+		CHEBYSHEV, // never overestimates but is looser than octile
+		ZERO // no estimate, which makes A* search like Dijkstra's algorithm
+	};
+
+	// one query of a batch
+	struct PathQuery
+	{
+		Vector2i start;
+		Vector2i end;
+		bool includeDiagonals;
+	};
+
+	// outcome of one query of a batch
+	struct PathQueryResult
+	{
+		PathStatus status;
+		int pathOffset; // index of the first position of the path in the batch's path buffer
+		int pathLength; // number of positions in the path
+	};
+
+	// how much work each side of a bidirectional search did
+	struct BidirectionalStats
+	{
+		int forwardExpanded; // cells expanded by the search from the start
+		int backwardExpanded; // cells expanded by the search from the end
+	};
+
+	// how much work an any-angle search did
+	struct AnyAngleStats
+	{
+		int expanded; // cells expanded by the search
+		int lineOfSightChecks; // calls to hasLineOfSight made by the search
+	};
+
+	// a search that runs a slice at a time, see beginPath
+	struct SlicedSearch
+	{
+		SearchContext context;
+		Vector2i start;
+		Vector2i end;
+		bool includeDiagonals;
+		unsigned long long revision; // grid revision the search began at
+		PathStatus status;
+	};
+
+	// outcome of a whole batch of queries
+	struct BatchPathResult
+	{
+		vector<PathQueryResult> results; // one per query, in query order
+		vector<Vector2i> paths; // every path found, back to back
+	};
+
+private:
+	// scratch state of one worker thread during a batch
+	struct BatchWorker
+	{
+		SearchContext context;
+		vector<Vector2i> path; // path of the current query
+		vector<Vector2i> paths; // paths found by this worker
 	};
 
 private:
 	// private instance variables
 	Grid<GridNode> *grid;
+	// which cells are occupied, read by the searches instead of the nodes
+	OccupancyGrid *occupancy;
+	// multiplier of the cost of moving into each cell, by cell id
+	vector<unsigned char> terrainCosts;
+	// distance of each cell to the nearest obstacle, NULL until buildClearanceMap
+	ClearanceMap *clearanceMap;
+	// which cells can reach each other, for paths without and with diagonals,
+	// NULL until a query first needs them
+	ComponentMap *componentMaps[2];
+	// whether each component map matches the grid, cleared by invalidateComponents
+	atomic<bool> componentsCurrent[2];
+	// held while a component map is built, since queries on several threads can ask for it
+	mutex componentLock;
 	int outlineThickness;
+	// algorithm used by findPath
+	SearchEngine searchEngine;
+	// estimate used by the A* engine
+	Heuristic heuristic;
+	// scratch state for the queries made through getShortestPath
+	SearchContext *searchContext;
+	// scratch state for the backward half of getShortestPathBidirectional
+	SearchContext *reverseSearchContext;
+	// path of the last getShortestPath or drawShortestPath, kept so
+	// redrawing every frame doesn't allocate
+	vector<Vector2i> lastPath;
+	// work done by the queries made through getShortestPath
+	SearchStatistics statistics;
+	// scratch state for the worker threads of findPaths
+	vector<BatchWorker*> batchWorkers;
+	// objects told about every change to the grid
+	vector<GridChangeListener*> listeners;
+	// number of changes to the grid that can change a path
+	unsigned long long revision;
 
 	Vector2i* startPos;
 	Vector2i* endPos;
 
-	int getDistance(GridNode* node1, GridNode* node2);
-
 public:
 	PathFinder(int width, int height, int cellSize);
 
 	PathFinder(int width, int height, int cellSize, int outlineThickness);
 
+	PathFinder(GridFile *file, int cellSize);
+
 	~PathFinder();
 
 	Grid<GridNode> *getGrid();
 
+	OccupancyGrid *getOccupancy();
+
+	bool saveGridFile(const string &fileName);
+
+	int getOutlineThickness();
+
 	void drawGrid(RenderWindow *window);
 
 	bool setValAt(int x, int y, GridValue val);
 
 	bool setValAt(Vector2i pos, GridValue val);
 
+	bool setTerrainCostAt(int x, int y, int cost);
+
+	int getTerrainCostAt(int x, int y);
+
+	unsigned char *getTerrainCosts();
+
+	void addChangeListener(GridChangeListener *listener);
+
+	void removeChangeListener(GridChangeListener *listener);
+
+	unsigned long long getRevision();
+
+	void buildClearanceMap(ThreadPool *pool);
+
+	ClearanceMap *getClearanceMap();
+
+	ComponentMap *getComponentMap(bool includeDiagonals);
+
+	void invalidateComponents();
+
+	bool isWalkable(int x, int y);
+
+	static int getDistance(Vector2i pos1, Vector2i pos2);
+
+	static int getStraightLineCost(Vector2i pos1, Vector2i pos2);
+
+	bool hasLineOfSight(Vector2i from, Vector2i to);
+
+	int getPathCost(Vector2i start, const vector<Vector2i> *path);
+
+	Vector2i *getStartPos();
+
+	Vector2i *getEndPos();
+
+	SearchEngine getSearchEngine();
+
+	void setSearchEngine(SearchEngine engine);
+
+	Heuristic getHeuristic();
+
+	void setHeuristic(Heuristic heuristic);
+
 	vector<GridNode *> *getShortestPath(bool includeDiagonals);
 
+	bool getShortestPath(bool includeDiagonals, vector<GridNode *> *path);
+
+	bool getShortestPath(bool includeDiagonals, int agentRadius, vector<GridNode *> *path);
+
+	PathStatus findPath(Vector2i start, Vector2i end, bool includeDiagonals,
+		SearchContext *context, vector<Vector2i> *path);
+
+	PathStatus findPath(Vector2i start, Vector2i end, bool includeDiagonals,
+		SearchContext *context, Vector2i *pathBuffer, int bufferSize, int *pathLength);
+
+	PathStatus findPath(Vector2i start, Vector2i end, bool includeDiagonals, int agentRadius,
+		SearchContext *context, vector<Vector2i> *path);
+
+	PathStatus findPath(Vector2i start, Vector2i end, bool includeDiagonals, int agentRadius,
+		SearchContext *context, vector<Vector2i> *path, QueryStats *stats);
+
+	SearchStatistics *getStatistics();
+
+	vector<GridNode *> *getShortestPathBidirectional(bool includeDiagonals, BidirectionalStats *stats);
+
+	PathStatus findBidirectionalPath(Vector2i start, Vector2i end, bool includeDiagonals,
+		SearchContext *forwardContext, SearchContext *backwardContext,
+		vector<Vector2i> *path, BidirectionalStats *stats);
+
+	PathStatus findAnyAnglePath(Vector2i start, Vector2i end, SearchContext *context,
+		vector<Vector2i> *waypoints, AnyAngleStats *stats);
+
+	void findPaths(const PathQuery *queries, int numQueries, ThreadPool *pool, BatchPathResult *result);
+
+	PathStatus beginPath(Vector2i start, Vector2i end, bool includeDiagonals, SlicedSearch *search);
+
+	PathStatus stepPath(SlicedSearch *search, int maxExpansions, int maxMicroseconds, vector<Vector2i> *path);
+
 	bool drawShortestPath(RenderWindow* window, bool includeDiagonals);
 
+	void drawPath(RenderWindow* window, const vector<Vector2i> *path);
+
 private:
 	void initializeNodes();
 
-	vector<GridNode*> *retracePath(GridNode* startNode, GridNode* endNode);
+	bool isPassable(int id);
+
+	void changeValAt(int x, int y, GridValue val);
+
+	bool isConnected(Vector2i start, Vector2i end, bool includeDiagonals);
+
+	void retracePath(SearchContext *context, int startId, int endId, vector<Vector2i> *path);
+
+	int retracePath(SearchContext *context, int startId, int endId, Vector2i *pathBuffer, int bufferSize);
+
+	PathStatus search(Vector2i start, Vector2i end, bool includeDiagonals, int agentRadius,
+		SearchContext *context);
+
+	PathStatus findAStarPath(Vector2i start, Vector2i end, bool includeDiagonals, int agentRadius,
+		SearchContext *context, bool resume, int maxExpansions);
+
+	template <typename Connectivity>
+	PathStatus findAStarPathWith(Vector2i start, Vector2i end, int agentRadius, SearchContext *context,
+		bool resume, int maxExpansions);
+
+	template <typename Connectivity, typename HeuristicPolicy, typename Costs>
+	PathStatus searchAStar(Vector2i start, Vector2i end, int agentRadius, SearchContext *context,
+		bool resume, int maxExpansions);
+
+	template <typename Connectivity>
+	PathStatus findWeightedPath(Vector2i start, Vector2i end, int agentRadius, SearchContext *context);
+
+	PathStatus findJumpPointPath(Vector2i start, Vector2i end, bool includeDiagonals, SearchContext *context);
+
+	int jump(int x, int y, int dx, int dy, Vector2i end, bool includeDiagonals);
+
+	int findCheapestClosedNeighbour(SearchContext *context, int id, int *gCost);
+
+	int jumpHorizontal(int x, int y, int dx, Vector2i end, bool includeDiagonals);
+
+	void expandBidirectional(SearchContext *context, SearchContext *otherContext, Vector2i target,
+		bool includeDiagonals, int *bestCost, int *meetingId);
 };
 
 /// <summary>
-/// Initialize the nodes in the grid
+/// Initialize the nodes in the grid. The nodes are stored by value
+/// in the grid so this only has to fill in their positions, and mark
+/// the cells that the occupancy grid starts with as occupied.
 /// </summary>
 void PathFinder::initializeNodes()
 {
-	for (int x = 0; x < grid->getGridWidth(); x++)
+	GridNode* node = grid->getData();
+	int id = 0;
+	for (int y = 0; y < grid->getGridHeight(); y++)
 	{
-		for (int y = 0; y < grid->getGridHeight(); y++)
+		for (int x = 0; x < grid->getGridWidth(); x++)
 		{
-			GridNode* newNode = new GridNode();
-			newNode->gridPos = Vector2i(x, y);
-			grid->setValAt(x, y, newNode);
+			node->gridPos = Vector2i(x, y);
+			if (occupancy->isOccupied(id))
+			{
+				node->val = GridValue::OCCUPIED;
+			}
+			node++;
+			id++;
 		}
 	}
 }
 
+/// <summary>
+/// Check if a path can go through the cell with the given id
+/// </summary>
+/// <param name="id">the id of a cell, which is its index in the grid</param>
+/// <returns>true if the cell is not occupied and false otherwise</returns>
+bool PathFinder::isPassable(int id)
+{
+	return !occupancy->isOccupied(id);
+}
+
+/// <summary>
+/// Check if a path can go through the given grid coordinates
+/// </summary>
+/// <param name="x">the x coordinate of a cell</param>
+/// <param name="y">the y coordinate of a cell</param>
+/// <returns>true if the coordinates are in the grid and the cell
+/// is not occupied, and false otherwise</returns>
+bool PathFinder::isWalkable(int x, int y)
+{
+	return grid->validCoords(x, y) && isPassable(grid->toIndex(x, y));
+}
+
+/// <summary>
+/// Check if a path could join two valid grid positions, without searching
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <returns>false if the end is in another component than the start and true otherwise</returns>
+bool PathFinder::isConnected(Vector2i start, Vector2i end, bool includeDiagonals)
+{
+	if (start == end)
+	{
+		return true;
+	}
+	return getComponentMap(includeDiagonals)->mayConnect(grid->toIndex(start.x, start.y),
+		grid->toIndex(end.x, end.y));
+}
+
 /// <summary>
 /// Constructor for a new PathFinder object
 /// </summary>
@@ -114,12 +394,24 @@ void PathFinder::initializeNodes()
 PathFinder::PathFinder(int width, int height, int cellSize)
 {
 	grid = new Grid<GridNode>(width, height, cellSize);
+	occupancy = new OccupancyGrid(width, height);
 	outlineThickness = 1;
+	searchEngine = SearchEngine::A_STAR;
+	heuristic = Heuristic::OCTILE;
+	terrainCosts.assign(width * height, MIN_TERRAIN_COST);
+	clearanceMap = NULL;
+	searchContext = new SearchContext(width * height);
+	reverseSearchContext = NULL;
+	revision = 0;
 
 	startPos = NULL;
 	endPos = NULL;
 
 	initializeNodes();
+	componentMaps[0] = NULL;
+	componentMaps[1] = NULL;
+	componentsCurrent[0] = false;
+	componentsCurrent[1] = false;
 }
 
 /// <summary>
@@ -132,12 +424,56 @@ PathFinder::PathFinder(int width, int height, int cellSize)
 PathFinder::PathFinder(int width, int height, int cellSize, int outlineThickness)
 {
 	grid = new Grid<GridNode>(width, height, cellSize);
+	occupancy = new OccupancyGrid(width, height);
 	this->outlineThickness = outlineThickness;
+	searchEngine = SearchEngine::A_STAR;
+	heuristic = Heuristic::OCTILE;
+	terrainCosts.assign(width * height, MIN_TERRAIN_COST);
+	clearanceMap = NULL;
+	searchContext = new SearchContext(width * height);
+	reverseSearchContext = NULL;
+	revision = 0;
+
+	startPos = NULL;
+	endPos = NULL;
+
+	initializeNodes();
+	componentMaps[0] = NULL;
+	componentMaps[1] = NULL;
+	componentsCurrent[0] = false;
+	componentsCurrent[1] = false;
+}
+
+/// <summary>
+/// Constructor for a PathFinder that searches a mapped grid file in place.
+/// The file must stay open for the life of the PathFinder. Changes to the
+/// grid are not written back to the file.
+/// </summary>
+/// <param name="file">an open grid file</param>
+/// <param name="cellSize">the size of each grid cell</param>
+PathFinder::PathFinder(GridFile *file, int cellSize)
+{
+	int width = file->getWidth();
+	int height = file->getHeight();
+	grid = new Grid<GridNode>(width, height, cellSize);
+	occupancy = new OccupancyGrid(width, height, file->getWords());
+	outlineThickness = 1;
+	searchEngine = SearchEngine::A_STAR;
+	heuristic = Heuristic::OCTILE;
+	terrainCosts.assign(width * height, MIN_TERRAIN_COST);
+	clearanceMap = NULL;
+	searchContext = new SearchContext(width * height);
+	reverseSearchContext = NULL;
+	revision = 0;
 
 	startPos = NULL;
 	endPos = NULL;
 
 	initializeNodes();
+	componentMaps[0] = NULL;
+	componentMaps[1] = NULL;
+	componentsCurrent[0] = false;
+	componentsCurrent[1] = false;
 }
 
 /// <summary>
@@ -145,18 +481,16 @@ PathFinder::PathFinder(int width, int height, int cellSize, int outlineThickness
 /// </summary>
 PathFinder::~PathFinder()
 {
-	cout << "startPos == null: " << (startPos == NULL) << endl;
-	cout << "destPos == null: " << (endPos == NULL) << endl;
-
-	for (int x = 0; x < grid->getGridWidth(); x++)
+	delete(clearanceMap);
+	delete(componentMaps[0]);
+	delete(componentMaps[1]);
+	delete(searchContext);
+	delete(reverseSearchContext);
+	for (int i = 0; i < batchWorkers.size(); i++)
 	{
-		for (int y = 0; y < grid->getGridHeight(); y++)
-		{
-			GridNode* currNode = grid->getValueAt(x, y);
-			delete(currNode);
-		}
+		delete(batchWorkers[i]);
 	}
-
+	delete(occupancy);
 	delete(grid);
 }
 
@@ -170,7 +504,36 @@ Grid<PathFinder::GridNode>* PathFinder::getGrid()
 }
 
 /// <summary>
-/// Draws this grid in the given window
+/// Get the occupancy bits used by the searches
+/// </summary>
+/// <returns>which cells of the grid are occupied</returns>
+OccupancyGrid *PathFinder::getOccupancy()
+{
+	return occupancy;
+}
+
+/// <summary>
+/// Save which cells are occupied to a grid file
+/// </summary>
+/// <param name="fileName">the path of the file to write</param>
+/// <returns>true if the file was written and false otherwise</returns>
+bool PathFinder::saveGridFile(const string &fileName)
+{
+	return GridFile::save(fileName, occupancy);
+}
+
+/// <summary>
+/// Get the thickness of the outline drawn around each cell
+/// </summary>
+/// <returns>the outline thickness in pixels</returns>
+int PathFinder::getOutlineThickness()
+{
+	return outlineThickness;
+}
+
+/// <summary>
+/// Draws this grid in the given window, one shape per cell. GridRenderer
+/// draws the same grid with a single draw call.
 /// </summary>
 /// <param name="window">window to draw into</param>
 void PathFinder::drawGrid(RenderWindow *window)
@@ -179,24 +542,26 @@ void PathFinder::drawGrid(RenderWindow *window)
 	int gridHeight = grid->getGridHeight();
 	int cellSize = grid->getCellSize();
 
-	for (int x = 0; x < gridWidth; x++)
+	// walk the nodes in storage order, one row at a time
+	for (int y = 0; y < gridHeight; y++)
 	{
-		for (int y = 0; y < gridHeight; y++)
+		PathFinder::GridNode *node = grid->getData() + y * grid->getStride();
+		for (int x = 0; x < gridWidth; x++, node++)
 		{
-			PathFinder::GridNode *node = grid->getValueAt(x, y);
-			if (node != NULL)
-			{
-				RectangleShape cell = RectangleShape(Vector2f(cellSize, cellSize));
-				Vector2f pos = grid->gridToScreen(x, y);
-				cell.setPosition(pos);
-				cell.setOutlineThickness(outlineThickness);
+			RectangleShape cell = RectangleShape(Vector2f(cellSize, cellSize));
+			Vector2f pos = grid->gridToScreen(x, y);
+			cell.setPosition(pos);
+			cell.setOutlineThickness(outlineThickness);
 
-				GridStateColor color = valToColor(node->val);
-				cell.setFillColor(Color((unsigned long)color));
-				cell.setOutlineColor(Color::White);
+			unsigned long color = (unsigned long)valToColor(node->val);
+			if (node->val == GridValue::UNOCCUPIED)
+			{
+				color = terrainToColor(terrainCosts[grid->toIndex(x, y)]);
+			}
+			cell.setFillColor(Color(color));
+			cell.setOutlineColor(Color::White);
 
-				window->draw(cell);
-			}				
+			window->draw(cell);
 		}
 	}
 }
@@ -226,8 +591,7 @@ bool PathFinder::setValAt(int x, int y, GridValue val)
 		else
 		{
 			// unoccupy old start pos
-			GridNode *oldStart = grid->getValueAt(startPos->x, startPos->y);
-			oldStart->val = GridValue::UNOCCUPIED;
+			changeValAt(startPos->x, startPos->y, GridValue::UNOCCUPIED);
 
 			// set new start pos
 			startPos->x = x;
@@ -244,8 +608,7 @@ bool PathFinder::setValAt(int x, int y, GridValue val)
 		else
 		{
 			// unoccupy old end pos
-			GridNode* oldEnd = grid->getValueAt(endPos->x, endPos->y);
-			oldEnd->val = GridValue::UNOCCUPIED;
+			changeValAt(endPos->x, endPos->y, GridValue::UNOCCUPIED);
 
 			// set new dest pos
 			endPos->x = x;
@@ -271,183 +634,1847 @@ bool PathFinder::setValAt(int x, int y, GridValue val)
 	}
 
 	// set the value at the cell
-	grid->getValueAt(x, y)->val = val;
+	changeValAt(x, y, val);
 
 	return true;
 }
 
 /// <summary>
-/// Set the value at the given screen pos
+/// Set the value of a cell and tell the listeners if it changed
 /// </summary>
-/// <param name="pos">The screen position of the desired grid</param>
-/// <param name="val">the new value of the cell at the given screen position</param>
-/// <returns>true if the position is valid and false otherwise</returns>
-bool PathFinder::setValAt(Vector2i pos, GridValue val)
+/// <param name="x">the x coordinate of a cell in the grid</param>
+/// <param name="y">the y coordinate of a cell in the grid</param>
+/// <param name="val">the new value of the cell</param>
+void PathFinder::changeValAt(int x, int y, GridValue val)
 {
-	Vector2i gridPos = grid->screenToGrid(pos);
-	return setValAt(gridPos.x, gridPos.y, val);
+	GridNode* node = grid->getValueAt(x, y);
+	GridValue oldVal = node->val;
+	node->val = val;
+
+	if (oldVal != val)
+	{
+		// only passability matters to paths
+		if ((oldVal == GridValue::OCCUPIED) != (val == GridValue::OCCUPIED))
+		{
+			occupancy->setOccupied(grid->toIndex(x, y), val == GridValue::OCCUPIED);
+			if (clearanceMap != NULL)
+			{
+				clearanceMap->update(x, y);
+			}
+			// maps that aren't current are relabelled in one go when next needed
+			for (int i = 0; i < 2; i++)
+			{
+				if (componentsCurrent[i])
+				{
+					componentMaps[i]->update(x, y);
+				}
+			}
+			revision++;
+		}
+		for (int i = 0; i < listeners.size(); i++)
+		{
+			listeners[i]->onCellChanged(x, y, oldVal, val);
+		}
+	}
 }
 
 /// <summary>
-/// Find the distance between two nodes. Distance is given as a cost
+/// Start telling the given listener about every change to the grid
 /// </summary>
-/// <param name="node1">a grid node</param>
-/// <param name="node2">a grid onde</param>
-/// <returns>the distance between two nodes given as a cost</returns>
-int PathFinder::getDistance(GridNode* node1, GridNode* node2)
+/// <param name="listener">the listener to add</param>
+void PathFinder::addChangeListener(GridChangeListener *listener)
 {
-	// cost of moves
-	const int DIAGONAL_COST = 14;
-	const int NORMAL_COST = 10;
-
-	// distance between the two nodes
-	int xDist = abs(node1->gridPos.x - node2->gridPos.x);
-	int yDist = abs(node1->gridPos.y - node2->gridPos.y);
-
-	// find the number of diagonal and normal moves
-	int numOfDiagonals = min(xDist, yDist);
-	int numOfNormMoves = abs(xDist - yDist);
+	listeners.push_back(listener);
+}
 
-	return DIAGONAL_COST * numOfDiagonals + NORMAL_COST * numOfNormMoves;
+/// <summary>
+/// Stop telling the given listener about changes to the grid
+/// </summary>
+/// <param name="listener">the listener to remove</param>
+void PathFinder::removeChangeListener(GridChangeListener *listener)
+{
+	listeners.erase(remove(listeners.begin(), listeners.end(), listener), listeners.end());
 }
 
 /// <summary>
-/// Retrace the path from the end node to the start node
+/// Set how much moving into a cell costs, as a multiple of the plain move
+/// cost. Only the WEIGHTED engine takes terrain costs into account, the
+/// other engines and the planners treat every passable cell alike.
 /// </summary>
-/// <param name="endNode">the end node in the grid</param>
-/// <param name="startNode">the starting node in the grid</param>
-/// <returns>the path from the end node to the start node as a vector of nodes
-/// starting with the starting node</returns>
-vector<PathFinder::GridNode*> *PathFinder::retracePath(GridNode *startNode, GridNode *endNode)
+/// <param name="x">the x coordinate of a cell in the grid</param>
+/// <param name="y">the y coordinate of a cell in the grid</param>
+/// <param name="cost">the terrain cost, from MIN_TERRAIN_COST to MAX_TERRAIN_COST</param>
+/// <returns>true if the coordinates and cost are valid and false otherwise</returns>
+bool PathFinder::setTerrainCostAt(int x, int y, int cost)
 {
-	vector<GridNode*>* path = new vector<GridNode*>();
-	GridNode* currNode = endNode;
-	// traverse the path backwards starting from the end node
-	// and add every node in the path to the path vector
-	while (currNode != startNode)
+	if (!grid->validCoords(x, y) || cost < MIN_TERRAIN_COST || cost > MAX_TERRAIN_COST)
 	{
-		path->push_back(currNode);
-		currNode = currNode->parentNode;
+		return false;
 	}
-	// reverse the path vector
-	reverse(path->begin(), path->end());
 
-	return path;
+	int id = grid->toIndex(x, y);
+	int oldCost = terrainCosts[id];
+	if (oldCost != cost)
+	{
+		terrainCosts[id] = (unsigned char)cost;
+		revision++;
+		for (int i = 0; i < listeners.size(); i++)
+		{
+			listeners[i]->onTerrainChanged(x, y, oldCost, cost);
+		}
+	}
+	return true;
 }
 
 /// <summary>
-/// Get the shortest path from the start and end positions
+/// Get how much moving into a cell costs
 /// </summary>
-/// <returns>the shortest path from the start and end positions if 
-/// there are start and end positions, otherwise return NULL</returns>
-vector<PathFinder::GridNode *> *PathFinder::getShortestPath(bool includeDiagonals)
+/// <param name="x">the x coordinate of a cell in the grid</param>
+/// <param name="y">the y coordinate of a cell in the grid</param>
+/// <returns>the terrain cost of the cell, or -1 if the coordinates are invalid</returns>
+int PathFinder::getTerrainCostAt(int x, int y)
 {
-	// only find shortest path if a start and end exist
-	if (startPos == NULL || endPos == NULL)
+	if (!grid->validCoords(x, y))
 	{
-		return NULL;
+		return -1;
 	}
-	// get the start and end nodes
-	GridNode* startNode = grid->getValueAt(startPos->x, startPos->y);
-	GridNode* endNode = grid->getValueAt(endPos->x, endPos->y);
+	return terrainCosts[grid->toIndex(x, y)];
+}
 
-	// list holds the nodes that CAN be part of the path
-	vector<GridNode*> openList; 
-	// set holds the nodes that HAVE been picked for a path
-	unordered_set<GridNode*, NodeHash> closedSet;
+/// <summary>
+/// Get the terrain costs of every cell, by cell id. Writing to them
+/// directly doesn't tell the listeners or change the revision.
+/// </summary>
+/// <returns>the terrain cost of the first cell</returns>
+unsigned char *PathFinder::getTerrainCosts()
+{
+	return terrainCosts.data();
+}
 
-	// openList starts with the start node
-	openList.push_back(startNode);
+/// <summary>
+/// Get the revision of the grid, which goes up every time a cell changes
+/// between occupied and passable or its terrain cost changes. Paths found
+/// at the same revision are still shortest paths.
+/// </summary>
+/// <returns>the revision of the grid</returns>
+unsigned long long PathFinder::getRevision()
+{
+	return revision;
+}
 
-	while (openList.size() > 0)
+/// <summary>
+/// Compute the clearance of every cell so paths can be found for agents
+/// bigger than one cell. The map is kept up to date as the grid changes
+/// from then on. Building it again rebuilds it from scratch.
+/// </summary>
+/// <param name="pool">threads to build with, NULL to build on the calling thread</param>
+void PathFinder::buildClearanceMap(ThreadPool *pool)
+{
+	if (clearanceMap == NULL)
 	{
-		// find node with lowest fcost or lowest hcost if fcost are the same
-		GridNode* lowestCostNode = openList[0];
-		int pos = 0;
-		for (int i = 1; i < openList.size(); i++)
-		{
-			GridNode* currOpenNode = openList[i];
-			if (currOpenNode->fCost() < lowestCostNode->fCost()
-					|| (currOpenNode->fCost() == lowestCostNode->fCost()
-					&& currOpenNode->hCost <= lowestCostNode->hCost))
-			{
-				lowestCostNode = currOpenNode;
-				pos = i;
-			}
-		}
-
-		// remove lowest cost node from open list
-		// because we are going to consider it as part of a path
-		vector<GridNode*>::iterator it = openList.begin() + pos;
-		openList.erase(it);
-		// add lowest cost node to closed set
-		closedSet.insert(lowestCostNode);
+		clearanceMap = new ClearanceMap(occupancy, pool);
+	}
+	else
+	{
+		clearanceMap->rebuild(pool);
+	}
+}
 
-		// check to see if lowestCostNode is the end node
-		if (lowestCostNode == endNode)
-		{
-			return retracePath(startNode, endNode);
-		}
+/// <summary>
+/// Get the clearance of every cell
+/// </summary>
+/// <returns>the clearance map, or NULL if buildClearanceMap hasn't been called</returns>
+ClearanceMap *PathFinder::getClearanceMap()
+{
+	return clearanceMap;
+}
 
-		// update all neighbour nodes
-		Vector2i lowestCostPos = lowestCostNode->gridPos;
-		vector<GridNode*>* neighbours = grid->getNeighbours(lowestCostPos.x, lowestCostPos.y, includeDiagonals);
-		for (int i = 0; i < neighbours->size(); i++)
+/// <summary>
+/// Get the connected components of the passable cells, which are kept up
+/// to date as the grid changes. Each map floods the whole grid, so it is
+/// only built the first time it is asked for, like the clearance map, and
+/// grids that are never asked about connectivity don't pay for it.
+/// </summary>
+/// <param name="includeDiagonals">whether paths can move diagonally</param>
+/// <returns>the components for that kind of path</returns>
+ComponentMap *PathFinder::getComponentMap(bool includeDiagonals)
+{
+	int kind = includeDiagonals ? 1 : 0;
+	if (!componentsCurrent[kind].load(memory_order_acquire))
+	{
+		// another thread may have built it while this one waited
+		lock_guard<mutex> lock(componentLock);
+		if (!componentsCurrent[kind].load(memory_order_relaxed))
 		{
-			GridNode* currNeighbour = (*neighbours)[i];
-			// if the neighbour is occupied (so can't be moved to) or it
-			// is already considered as part of the path (is in closed set)
-			// then ignore it and move onto the next neighbour
-			if (currNeighbour->val == GridValue::OCCUPIED
-				|| closedSet.find(currNeighbour) != closedSet.end())
+			if (componentMaps[kind] == NULL)
 			{
-				continue;
+				componentMaps[kind] = new ComponentMap(occupancy, includeDiagonals);
 			}
-
-			int newMovementCostToNeighbour =
-				lowestCostNode->gCost + getDistance(lowestCostNode, currNeighbour);
-			bool isInOpenSet = find(openList.begin(), openList.end(), currNeighbour) 
-					!= openList.end();
-			// if the neighbour's current cost is greater than the new cost
-			// (aka part of a longer path) or the neighbour has not been 
-			// considered for a path yet, then update its values
-			if (newMovementCostToNeighbour < currNeighbour->gCost 
-					|| !isInOpenSet)
-			{
-				// set g and h costs of neighbour
-				currNeighbour->gCost = newMovementCostToNeighbour;
-				currNeighbour->hCost = getDistance(currNeighbour, endNode);
-				// set parent of neighbour to the lowestCostNode
-				currNeighbour->parentNode = lowestCostNode;
-				// add neighbour to open list if it is not in it
-				// (aka has not been considered for a path yet)
-				if (!isInOpenSet)
-				{
-					openList.push_back(currNeighbour);
-				}
+			else
+			{
+				componentMaps[kind]->rebuild();
 			}
+			componentsCurrent[kind].store(true, memory_order_release);
 		}
-
 	}
+	return componentMaps[kind];
 }
 
-bool PathFinder::drawShortestPath(RenderWindow* window, bool includeDiagonals)
+/// <summary>
+/// Mark the component maps out of date after the occupancy bits were
+/// written without setValAt, so each is relabelled in one go the next
+/// time it is needed
+/// </summary>
+void PathFinder::invalidateComponents()
 {
-	int cellSize = grid->getCellSize();
-
-	vector<GridNode*> *path = getShortestPath(includeDiagonals);
-	if (path == NULL)
-	{
-		return false;
-	}
+	componentsCurrent[0] = false;
+	componentsCurrent[1] = false;
+}
 
-	Color pathColor = Color::Green;
+/// <summary>
+/// Set the value at the given screen pos
+/// </summary>
+/// <param name="pos">The screen position of the desired grid</param>
+/// <param name="val">the new value of the cell at the given screen position</param>
+/// <returns>true if the position is valid and false otherwise</returns>
+bool PathFinder::setValAt(Vector2i pos, GridValue val)
+{
+	Vector2i gridPos = grid->screenToGrid(pos);
+	return setValAt(gridPos.x, gridPos.y, val);
+}
 
-	// draw the path
-	for (int i = 0; i < path->size(); i++)
-	{
-		GridNode *currNode = (*path)[i];
-		Vector2i currPos = currNode->gridPos;
+/// <summary>
+/// Get the position of the start cell
+/// </summary>
+/// <returns>the grid position of the start cell, or NULL if there is none</returns>
+Vector2i *PathFinder::getStartPos()
+{
+	return startPos;
+}
+
+/// <summary>
+/// Get the position of the destination cell
+/// </summary>
+/// <returns>the grid position of the destination cell, or NULL if there is none</returns>
+Vector2i *PathFinder::getEndPos()
+{
+	return endPos;
+}
+
+/// <summary>
+/// Get the algorithm used to answer path queries
+/// </summary>
+/// <returns>the algorithm used to answer path queries</returns>
+PathFinder::SearchEngine PathFinder::getSearchEngine()
+{
+	return searchEngine;
+}
+
+/// <summary>
+/// Set the algorithm used to answer path queries. The A* and jump point
+/// engines find paths of the same cost, the weighted engine finds the
+/// cheapest path once terrain costs are counted. Must not be changed while
+/// queries are running.
+/// </summary>
+/// <param name="engine">the algorithm to use</param>
+void PathFinder::setSearchEngine(SearchEngine engine)
+{
+	searchEngine = engine;
+}
+
+/// <summary>
+/// Get the estimate the A* engine uses
+/// </summary>
+/// <returns>the heuristic of A* searches</returns>
+PathFinder::Heuristic PathFinder::getHeuristic()
+{
+	return heuristic;
+}
+
+/// <summary>
+/// Set the estimate the A* engine uses. Only the octile, Chebyshev and
+/// zero heuristics always find shortest paths when diagonals are allowed.
+/// </summary>
+/// <param name="heuristic">the heuristic of A* searches</param>
+void PathFinder::setHeuristic(Heuristic heuristic)
+{
+	this->heuristic = heuristic;
+}
+
+/// <summary>
+/// Find the distance between two grid positions. Distance is given as a cost
+/// </summary>
+/// <param name="pos1">a grid position</param>
+/// <param name="pos2">a grid position</param>
+/// <returns>the distance between two grid positions given as a cost</returns>
+int PathFinder::getDistance(Vector2i pos1, Vector2i pos2)
+{
+	// the octile estimate is the exact cost of a straight-then-diagonal path
+	return OctileHeuristic<OctileCosts>::estimate(abs(pos1.x - pos2.x), abs(pos1.y - pos2.y));
+}
+
+/// <summary>
+/// Find the cost of moving in a straight line between two grid positions,
+/// in the same units as getDistance, so moves to neighbours cost the same
+/// </summary>
+/// <param name="pos1">a grid position</param>
+/// <param name="pos2">a grid position</param>
+/// <returns>the Euclidean distance times the straight move cost, rounded</returns>
+int PathFinder::getStraightLineCost(Vector2i pos1, Vector2i pos2)
+{
+	double xDist = pos1.x - pos2.x;
+	double yDist = pos1.y - pos2.y;
+	return (int)(sqrt(xDist * xDist + yDist * yDist) * OctileCosts::STRAIGHT + 0.5);
+}
+
+/// <summary>
+/// Check if the straight line between the centres of two cells only
+/// crosses passable cells. Touching the edge or corner of an occupied cell
+/// doesn't block the line, the same way diagonal moves can cut corners.
+/// The cells crossed are walked with integer steps only, and lines along
+/// a row test up to 64 cells at a time.
+/// </summary>
+/// <param name="from">the grid position the line starts from, which isn't tested</param>
+/// <param name="to">the grid position the line ends at</param>
+/// <returns>true if both positions are in the grid and every cell the line
+/// crosses after the first is passable, and false otherwise</returns>
+bool PathFinder::hasLineOfSight(Vector2i from, Vector2i to)
+{
+	if (!grid->validCoords(from.x, from.y) || !grid->validCoords(to.x, to.y))
+	{
+		return false;
+	}
+
+	int xDist = abs(to.x - from.x);
+	int yDist = abs(to.y - from.y);
+	int stepX = to.x > from.x ? 1 : -1;
+	int stepY = to.y > from.y ? 1 : -1;
+	if (yDist == 0)
+	{
+		// the cells after the first are one run of the row
+		int x = stepX > 0 ? from.x + 1 : to.x;
+		for (int count = xDist; count > 0; count -= 64, x += 64)
+		{
+			if (occupancy->getRowBits(x, from.y, min(count, 64)) != 0)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// error is how far the line is from the corner ahead, counted in half
+	// cells times the distances: above 0 it leaves through the side, below
+	// 0 through the top or bottom, and at 0 through the corner itself
+	int gridWidth = grid->getGridWidth();
+	int id = from.y * gridWidth + from.x;
+	int error = xDist - yDist;
+	for (int steps = xDist + yDist; steps > 0; steps--)
+	{
+		if (error > 0)
+		{
+			id += stepX;
+			error -= 2 * yDist;
+		}
+		else if (error < 0)
+		{
+			id += stepY * gridWidth;
+			error += 2 * xDist;
+		}
+		else
+		{
+			// passing exactly through a corner skips both cells beside it
+			id += stepY * gridWidth + stepX;
+			error += 2 * (xDist - yDist);
+			steps--;
+		}
+		if (occupancy->isOccupied(id))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/// <summary>
+/// Get the cost of a path as the current engine counts it, which includes
+/// the terrain costs for the weighted engine
+/// </summary>
+/// <param name="start">the grid position the path starts from</param>
+/// <param name="path">the grid positions of the path starting after the start</param>
+/// <returns>the cost of the path</returns>
+int PathFinder::getPathCost(Vector2i start, const vector<Vector2i> *path)
+{
+	int cost = 0;
+	Vector2i prev = start;
+	for (int i = 0; i < path->size(); i++)
+	{
+		Vector2i pos = (*path)[i];
+		int moveCost = getDistance(prev, pos);
+		if (searchEngine == SearchEngine::WEIGHTED)
+		{
+			moveCost *= terrainCosts[grid->toIndex(pos.x, pos.y)];
+		}
+		cost += moveCost;
+		prev = pos;
+	}
+	return cost;
+}
+
+/// <summary>
+/// Retrace the path from the end cell to the start cell
+/// </summary>
+/// <param name="context">the context of the search that reached the end</param>
+/// <param name="startId">the id of the starting cell</param>
+/// <param name="endId">the id of the end cell</param>
+/// <param name="path">filled with the grid positions of the path starting
+/// after the starting cell and ending with the end cell</param>
+void PathFinder::retracePath(SearchContext *context, int startId, int endId, vector<Vector2i> *path)
+{
+	// resizing keeps the capacity, so a reused vector only grows
+	// when a path is longer than any before it
+	path->resize(retracePath(context, startId, endId, NULL, 0));
+	retracePath(context, startId, endId, path->data(), (int)path->size());
+}
+
+/// <summary>
+/// Retrace the path from the end cell to the start cell into a buffer.
+/// Consecutive cells of the path don't have to be neighbours: the cells
+/// on the straight or diagonal line between a cell and its parent, like
+/// between jump points, are filled in.
+/// </summary>
+/// <param name="context">the context of the search that reached the end</param>
+/// <param name="startId">the id of the starting cell</param>
+/// <param name="endId">the id of the end cell</param>
+/// <param name="pathBuffer">filled with the grid positions of the path starting
+/// after the starting cell and ending with the end cell, if they fit</param>
+/// <param name="bufferSize">the number of positions the buffer has room for</param>
+/// <returns>the length of the path, which is more than bufferSize
+/// if the buffer was too small and was left alone</returns>
+int PathFinder::retracePath(SearchContext *context, int startId, int endId, Vector2i *pathBuffer, int bufferSize)
+{
+	// count the cells first so the path can be written in order from the back
+	int length = 0;
+	for (int currId = endId; currId != startId; currId = context->getParent(currId))
+	{
+		Vector2i currPos = grid->toCoords(currId);
+		Vector2i parentPos = grid->toCoords(context->getParent(currId));
+		length += max(abs(parentPos.x - currPos.x), abs(parentPos.y - currPos.y));
+	}
+	if (length > bufferSize)
+	{
+		return length;
+	}
+
+	int i = length;
+	for (int currId = endId; currId != startId; currId = context->getParent(currId))
+	{
+		// walk back from this cell to its parent
+		Vector2i currPos = grid->toCoords(currId);
+		Vector2i parentPos = grid->toCoords(context->getParent(currId));
+		int dx = (parentPos.x > currPos.x) - (parentPos.x < currPos.x);
+		int dy = (parentPos.y > currPos.y) - (parentPos.y < currPos.y);
+		while (currPos != parentPos)
+		{
+			pathBuffer[--i] = currPos;
+			currPos.x += dx;
+			currPos.y += dy;
+		}
+	}
+	return length;
+}
+
+/// <summary>
+/// Get the shortest path from the start and end positions
+/// </summary>
+/// <returns>the shortest path from the start and end positions if 
+/// there are start and end positions, otherwise return NULL</returns>
+vector<PathFinder::GridNode *> *PathFinder::getShortestPath(bool includeDiagonals)
+{
+	vector<GridNode*>* path = new vector<GridNode*>();
+	if (!getShortestPath(includeDiagonals, path))
+	{
+		delete(path);
+		return NULL;
+	}
+	return path;
+}
+
+/// <summary>
+/// Get the shortest path from the start and end positions into a vector
+/// owned by the caller, which doesn't allocate once the vector has grown
+/// to the length of the paths
+/// </summary>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="path">filled with the nodes of the path</param>
+/// <returns>true if there are start and end positions and a path
+/// between them, and false otherwise</returns>
+bool PathFinder::getShortestPath(bool includeDiagonals, vector<GridNode *> *path)
+{
+	return getShortestPath(includeDiagonals, 0, path);
+}
+
+/// <summary>
+/// Get the shortest path from the start and end positions for an agent
+/// that covers more than one cell, into a vector owned by the caller
+/// </summary>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="agentRadius">the number of cells the agent covers on every
+/// side of its own, 0 for an agent of one cell</param>
+/// <param name="path">filled with the nodes of the path, empty if there is none</param>
+/// <returns>true if a path was found and false otherwise</returns>
+bool PathFinder::getShortestPath(bool includeDiagonals, int agentRadius, vector<GridNode *> *path)
+{
+	path->clear();
+	// only find shortest path if a start and end exist
+	if (startPos == NULL || endPos == NULL)
+	{
+		return false;
+	}
+
+	QueryStats stats;
+	PathStatus status = findPath(*startPos, *endPos, includeDiagonals, agentRadius, searchContext, &lastPath, &stats);
+	statistics.record(stats);
+	if (status != PathStatus::FOUND)
+	{
+		return false;
+	}
+
+	// look up the node at every position of the path
+	path->reserve(lastPath.size());
+	for (int i = 0; i < lastPath.size(); i++)
+	{
+		path->push_back(grid->getValueAt(lastPath[i].x, lastPath[i].y));
+	}
+	return true;
+}
+
+/// <summary>
+/// Find the shortest path between two grid positions. The grid is only
+/// read, so several threads can search the same grid at once as long as
+/// each one uses its own context and the grid isn't changed meanwhile.
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="context">scratch state for the search, reused across calls.
+/// Setting its cancel flag from another thread stops the search.</param>
+/// <param name="path">filled with the grid positions of the path starting
+/// after the start and ending with the end if a path is found</param>
+/// <returns>whether a path was found</returns>
+PathFinder::PathStatus PathFinder::findPath(Vector2i start, Vector2i end, bool includeDiagonals,
+	SearchContext *context, vector<Vector2i> *path)
+{
+	return findPath(start, end, includeDiagonals, 0, context, path);
+}
+
+/// <summary>
+/// Find the shortest path between two grid positions for an agent that
+/// covers the square of cells within a radius of its own, so that every
+/// cell the agent covers along the path is passable. Radii above 0 need
+/// the clearance map, which the first such call builds if buildClearanceMap
+/// hasn't been called, so call that first when searching from several
+/// threads. Jump point queries run as A* for radii above 0.
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="agentRadius">the number of cells the agent covers on every
+/// side of its own, 0 for an agent of one cell. Radii of MAX_CLEARANCE or
+/// more never fit.</param>
+/// <param name="context">scratch state for the search, reused across calls</param>
+/// <param name="path">filled with the grid positions of the path starting
+/// after the start and ending with the end if a path is found</param>
+/// <returns>whether a path was found</returns>
+PathFinder::PathStatus PathFinder::findPath(Vector2i start, Vector2i end, bool includeDiagonals, int agentRadius,
+	SearchContext *context, vector<Vector2i> *path)
+{
+	return findPath(start, end, includeDiagonals, agentRadius, context, path, NULL);
+}
+
+/// <summary>
+/// Find the shortest path between two grid positions like the other
+/// findPath, and measure how much work the query took. The counts come
+/// from the context, so they cost a few increments per cell either way;
+/// only the path cost is skipped without stats.
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="agentRadius">the number of cells the agent covers on every
+/// side of its own, 0 for an agent of one cell</param>
+/// <param name="context">scratch state for the search, reused across calls</param>
+/// <param name="path">filled with the grid positions of the path starting
+/// after the start and ending with the end if a path is found</param>
+/// <param name="stats">filled with the work the query did, NULL if not needed</param>
+/// <returns>whether a path was found</returns>
+PathFinder::PathStatus PathFinder::findPath(Vector2i start, Vector2i end, bool includeDiagonals, int agentRadius,
+	SearchContext *context, vector<Vector2i> *path, QueryStats *stats)
+{
+	auto queryStart = chrono::steady_clock::now();
+	if (agentRadius > 0 && clearanceMap == NULL)
+	{
+		buildClearanceMap(NULL);
+	}
+
+	// queries turned down before searching would report the previous search
+	context->resetCounts();
+	PathStatus status = search(start, end, includeDiagonals, agentRadius, context);
+	if (status == PathStatus::FOUND)
+	{
+		retracePath(context, grid->toIndex(start.x, start.y), grid->toIndex(end.x, end.y), path);
+	}
+
+	if (stats != NULL)
+	{
+		// measured before the path cost, which isn't part of the query
+		stats->microseconds = chrono::duration_cast<chrono::microseconds>(
+			chrono::steady_clock::now() - queryStart).count();
+		stats->found = status == PathStatus::FOUND;
+		stats->expanded = context->getExpandedCount();
+		stats->generated = context->getGeneratedCount();
+		stats->openPeak = context->getOpenPeak();
+		stats->reopened = context->getReopenedCount();
+		stats->pathLength = stats->found ? (int)path->size() : 0;
+		stats->pathCost = stats->found ? getPathCost(start, path) : 0;
+	}
+	return status;
+}
+
+/// <summary>
+/// Get the totals and histograms of the queries made through getShortestPath
+/// </summary>
+/// <returns>the statistics, which can be cleared to start counting over</returns>
+SearchStatistics *PathFinder::getStatistics()
+{
+	return &statistics;
+}
+
+/// <summary>
+/// Find the shortest path between two grid positions into a buffer owned
+/// by the caller, so that nothing is allocated once the context has grown
+/// to the size of the grid. Can be called from several threads at once
+/// like the other findPath.
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="context">scratch state for the search, reused across calls</param>
+/// <param name="pathBuffer">filled with the grid positions of the path starting
+/// after the start and ending with the end if a path is found and fits</param>
+/// <param name="bufferSize">the number of positions the buffer has room for</param>
+/// <param name="pathLength">set to the length of the path if one is found. If
+/// that is more than bufferSize the buffer is left alone and the query can be
+/// repeated with a bigger buffer.</param>
+/// <returns>whether a path was found</returns>
+PathFinder::PathStatus PathFinder::findPath(Vector2i start, Vector2i end, bool includeDiagonals,
+	SearchContext *context, Vector2i *pathBuffer, int bufferSize, int *pathLength)
+{
+	*pathLength = 0;
+	context->resetCounts();
+	PathStatus status = search(start, end, includeDiagonals, 0, context);
+	if (status == PathStatus::FOUND)
+	{
+		*pathLength = retracePath(context, grid->toIndex(start.x, start.y), grid->toIndex(end.x, end.y),
+			pathBuffer, bufferSize);
+	}
+	return status;
+}
+
+/// <summary>
+/// Search for the end from the start with the current engine, leaving
+/// the path in the parents of the context
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="agentRadius">the number of cells the agent covers on every side of its own</param>
+/// <param name="context">scratch state for the search</param>
+/// <returns>whether a path was found</returns>
+PathFinder::PathStatus PathFinder::search(Vector2i start, Vector2i end, bool includeDiagonals, int agentRadius,
+	SearchContext *context)
+{
+	if (!grid->validCoords(start.x, start.y) || !grid->validCoords(end.x, end.y))
+	{
+		return PathStatus::INVALID_ENDPOINTS;
+	}
+	if (!isConnected(start, end, includeDiagonals))
+	{
+		return PathStatus::UNREACHABLE;
+	}
+
+	// jump points assume every passable cell can be stood on
+	if (searchEngine == SearchEngine::JUMP_POINT && agentRadius == 0)
+	{
+		return findJumpPointPath(start, end, includeDiagonals, context);
+	}
+	if (searchEngine == SearchEngine::WEIGHTED)
+	{
+		if (includeDiagonals)
+		{
+			return findWeightedPath<EightConnected>(start, end, agentRadius, context);
+		}
+		return findWeightedPath<FourConnected>(start, end, agentRadius, context);
+	}
+	return findAStarPath(start, end, includeDiagonals, agentRadius, context, false, INT_MAX);
+}
+
+/// <summary>
+/// Find the shortest path between two valid grid positions with A*,
+/// picking the search compiled for the connectivity and heuristic once
+/// per query
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="agentRadius">the number of cells the agent covers on every side of its own</param>
+/// <param name="context">scratch state for the search, left with the
+/// parents of the path if one is found</param>
+/// <param name="resume">whether to carry on with the search in the context
+/// instead of starting a new one</param>
+/// <param name="maxExpansions">the most cells to expand before returning IN_PROGRESS</param>
+/// <returns>whether a path was found</returns>
+PathFinder::PathStatus PathFinder::findAStarPath(Vector2i start, Vector2i end, bool includeDiagonals,
+	int agentRadius, SearchContext *context, bool resume, int maxExpansions)
+{
+	if (includeDiagonals)
+	{
+		return findAStarPathWith<EightConnected>(start, end, agentRadius, context, resume, maxExpansions);
+	}
+	return findAStarPathWith<FourConnected>(start, end, agentRadius, context, resume, maxExpansions);
+}
+
+/// <summary>
+/// Find the shortest path between two valid grid positions with A* for
+/// one connectivity, picking the search compiled for the heuristic
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="agentRadius">the number of cells the agent covers on every side of its own</param>
+/// <param name="context">scratch state for the search</param>
+/// <param name="resume">whether to carry on with the search in the context</param>
+/// <param name="maxExpansions">the most cells to expand before returning IN_PROGRESS</param>
+/// <returns>whether a path was found</returns>
+template <typename Connectivity>
+PathFinder::PathStatus PathFinder::findAStarPathWith(Vector2i start, Vector2i end, int agentRadius,
+	SearchContext *context, bool resume, int maxExpansions)
+{
+	switch (heuristic)
+	{
+	case Heuristic::MANHATTAN:
+		return searchAStar<Connectivity, ManhattanHeuristic<OctileCosts>, OctileCosts>(start, end, agentRadius,
+			context, resume, maxExpansions);
+	case Heuristic::CHEBYSHEV:
+		return searchAStar<Connectivity, ChebyshevHeuristic<OctileCosts>, OctileCosts>(start, end, agentRadius,
+			context, resume, maxExpansions);
+	case Heuristic::ZERO:
+		return searchAStar<Connectivity, ZeroHeuristic<OctileCosts>, OctileCosts>(start, end, agentRadius,
+			context, resume, maxExpansions);
+	default:
+		return searchAStar<Connectivity, OctileHeuristic<OctileCosts>, OctileCosts>(start, end, agentRadius,
+			context, resume, maxExpansions);
+	}
+}
+
+/// <summary>
+/// Find the shortest path between two valid grid positions with A*. The
+/// connectivity, heuristic and move costs are template parameters, so the
+/// neighbour mask, the move costs and the estimate are all constants in
+/// the inner loop.
+///
+/// The open and closed cells are all kept in the context, so a search that
+/// runs out of expansions can be carried on later from where it stopped.
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="agentRadius">the number of cells the agent covers on every
+/// side of its own, the neighbours it doesn't fit on are skipped</param>
+/// <param name="context">scratch state for the search</param>
+/// <param name="resume">whether to carry on with the search in the context,
+/// which must be for the same start and end, instead of starting a new one</param>
+/// <param name="maxExpansions">the most cells to expand before returning IN_PROGRESS</param>
+/// <returns>whether a path was found, or IN_PROGRESS</returns>
+template <typename Connectivity, typename HeuristicPolicy, typename Costs>
+PathFinder::PathStatus PathFinder::searchAStar(Vector2i start, Vector2i end, int agentRadius,
+	SearchContext *context, bool resume, int maxExpansions)
+{
+	int gridWidth = grid->getGridWidth();
+	int startId = grid->toIndex(start.x, start.y);
+	int endId = grid->toIndex(end.x, end.y);
+
+	// id offsets of the neighbours, so moving to one is a single add
+	int idOffsets[8];
+	for (int i = 0; i < 8; i++)
+	{
+		idOffsets[i] = NEIGHBOUR_Y_OFFSETS[i] * gridWidth + NEIGHBOUR_X_OFFSETS[i];
+	}
+
+	IndexedHeap<SearchContext::CostCompare>* openList = context->getOpenList();
+	if (!resume)
+	{
+		context->beginSearch(gridWidth * grid->getGridHeight());
+
+		// openList starts with the start cell
+		context->reach(startId, 0, HeuristicPolicy::estimate(abs(start.x - end.x), abs(start.y - end.y)), -1);
+		openList->push(startId);
+	}
+	else if (context->isReached(endId) && context->isClosed(endId))
+	{
+		// the end was found by an earlier slice
+		return PathStatus::FOUND;
+	}
+
+	for (int expansions = 0; !openList->isEmpty(); expansions++)
+	{
+		if (context->isCancelled())
+		{
+			return PathStatus::CANCELLED;
+		}
+		if (expansions == maxExpansions)
+		{
+			return PathStatus::IN_PROGRESS;
+		}
+
+		// take the cell with lowest fcost or lowest hcost if fcost are the same
+		// out of the open list and mark it as picked for a path
+		int lowestCostId = openList->pop();
+		context->close(lowestCostId);
+
+		// check to see if the lowest cost cell is the end cell
+		if (lowestCostId == endId)
+		{
+			return PathStatus::FOUND;
+		}
+
+		// update all neighbour cells that can be moved to
+		int x = lowestCostId % gridWidth;
+		int y = lowestCostId / gridWidth;
+		int lowestCost = context->getGCost(lowestCostId);
+		int neighbours = occupancy->getPassableNeighbours(x, y) & Connectivity::DIRECTIONS;
+		if (agentRadius > 0)
+		{
+			neighbours = clearanceMap->getFittingNeighbours(x, y, neighbours, agentRadius);
+		}
+		for (int i = 0; i < 8; i++)
+		{
+			int neighbour = NEIGHBOUR_SCAN_ORDER[i];
+			if ((neighbours & (1 << neighbour)) == 0)
+			{
+				continue;
+			}
+			int neighbourId = lowestCostId + idOffsets[neighbour];
+			bool isReached = context->isReached(neighbourId);
+			// if the neighbour is already considered as part of the
+			// path (is closed) then ignore it and move onto the next neighbour
+			if (isReached && context->isClosed(neighbourId))
+			{
+				continue;
+			}
+
+			int newMovementCostToNeighbour = lowestCost
+				+ (Connectivity::HAS_DIAGONALS ? Costs::moveCost(neighbour) : Costs::STRAIGHT);
+			// if the neighbour has not been considered for a path yet,
+			// add it to the open list
+			if (!isReached)
+			{
+				int xDist = abs(x + NEIGHBOUR_X_OFFSETS[neighbour] - end.x);
+				int yDist = abs(y + NEIGHBOUR_Y_OFFSETS[neighbour] - end.y);
+				context->reach(neighbourId, newMovementCostToNeighbour,
+					HeuristicPolicy::estimate(xDist, yDist), lowestCostId);
+				openList->push(neighbourId);
+			}
+			// if the neighbour's current cost is greater than the new cost
+			// (aka part of a longer path), update it and move it up the open list
+			else if (newMovementCostToNeighbour < context->getGCost(neighbourId))
+			{
+				context->setGCost(neighbourId, newMovementCostToNeighbour, lowestCostId);
+				openList->decreaseKey(neighbourId);
+			}
+		}
+	}
+
+	// the end cell can't be reached from the start cell
+	return PathStatus::UNREACHABLE;
+}
+
+/// <summary>
+/// Find the cheapest path between two valid grid positions with A*, where
+/// moving into a cell costs the plain move cost times the cell's terrain
+/// cost. Every move costs a small integer, so the open list is a bucket
+/// queue with one bucket per f cost instead of a heap, and pushing or
+/// popping a cell takes constant time.
+///
+/// The estimate is the octile distance at the lowest terrain cost, which
+/// never overestimates and never drops by more than a move costs, so f
+/// costs are popped in order and the path is the cheapest one. A cell whose
+/// cost drops is pushed again rather than moved, and its old entry is
+/// skipped when it comes out.
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="agentRadius">the number of cells the agent covers on every side of its own</param>
+/// <param name="context">scratch state for the search</param>
+/// <returns>whether a path was found</returns>
+template <typename Connectivity>
+PathFinder::PathStatus PathFinder::findWeightedPath(Vector2i start, Vector2i end, int agentRadius,
+	SearchContext *context)
+{
+	int gridWidth = grid->getGridWidth();
+	int startId = grid->toIndex(start.x, start.y);
+	int endId = grid->toIndex(end.x, end.y);
+
+	int idOffsets[8];
+	for (int i = 0; i < 8; i++)
+	{
+		idOffsets[i] = NEIGHBOUR_Y_OFFSETS[i] * gridWidth + NEIGHBOUR_X_OFFSETS[i];
+	}
+
+	context->beginSearch(gridWidth * grid->getGridHeight());
+	BucketQueue* openList = context->getBucketQueue();
+	// a pushed f cost is at most the dearest move plus the biggest drop
+	// of the estimate above the f cost being expanded
+	const int F_COST_SPREAD = OctileCosts::DIAGONAL * MAX_TERRAIN_COST + OctileCosts::DIAGONAL + 1;
+	int startHCost = getDistance(start, end) * MIN_TERRAIN_COST;
+	openList->reset(F_COST_SPREAD, startHCost);
+	context->reach(startId, 0, startHCost, -1);
+	openList->push(startId, startHCost);
+
+	while (!openList->isEmpty())
+	{
+		if (context->isCancelled())
+		{
+			return PathStatus::CANCELLED;
+		}
+
+		int fCost;
+		int lowestCostId = openList->pop(&fCost);
+		// skip entries left behind by cells that were pushed again
+		if (context->isClosed(lowestCostId) || context->getFCost(lowestCostId) != fCost)
+		{
+			continue;
+		}
+		context->close(lowestCostId);
+
+		if (lowestCostId == endId)
+		{
+			return PathStatus::FOUND;
+		}
+
+		int x = lowestCostId % gridWidth;
+		int y = lowestCostId / gridWidth;
+		int lowestCost = context->getGCost(lowestCostId);
+		int neighbours = occupancy->getPassableNeighbours(x, y) & Connectivity::DIRECTIONS;
+		if (agentRadius > 0)
+		{
+			neighbours = clearanceMap->getFittingNeighbours(x, y, neighbours, agentRadius);
+		}
+		while (neighbours != 0)
+		{
+			int neighbour = popNeighbour(&neighbours);
+			int neighbourId = lowestCostId + idOffsets[neighbour];
+			bool isReached = context->isReached(neighbourId);
+			if (isReached && context->isClosed(neighbourId))
+			{
+				continue;
+			}
+
+			int moveCost = Connectivity::HAS_DIAGONALS ? OctileCosts::moveCost(neighbour) : OctileCosts::STRAIGHT;
+			int newMovementCostToNeighbour = lowestCost + moveCost * terrainCosts[neighbourId];
+			if (!isReached)
+			{
+				int xDist = abs(x + NEIGHBOUR_X_OFFSETS[neighbour] - end.x);
+				int yDist = abs(y + NEIGHBOUR_Y_OFFSETS[neighbour] - end.y);
+				int hCost = OctileHeuristic<OctileCosts>::estimate(xDist, yDist) * MIN_TERRAIN_COST;
+				context->reach(neighbourId, newMovementCostToNeighbour, hCost, lowestCostId);
+				openList->push(neighbourId, newMovementCostToNeighbour + hCost);
+			}
+			else if (newMovementCostToNeighbour < context->getGCost(neighbourId))
+			{
+				context->setGCost(neighbourId, newMovementCostToNeighbour, lowestCostId);
+				openList->push(neighbourId, context->getFCost(neighbourId));
+			}
+		}
+	}
+
+	// the end cell can't be reached from the start cell
+	return PathStatus::UNREACHABLE;
+}
+
+/// <summary>
+/// Get the shortest path from the start and end positions using a search
+/// from each end at once
+/// </summary>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="stats">filled with the number of cells each side expanded</param>
+/// <returns>the shortest path from the start and end positions if
+/// there are start and end positions, otherwise return NULL</returns>
+vector<PathFinder::GridNode *> *PathFinder::getShortestPathBidirectional(bool includeDiagonals,
+	BidirectionalStats *stats)
+{
+	stats->forwardExpanded = 0;
+	stats->backwardExpanded = 0;
+
+	// only find shortest path if a start and end exist
+	if (startPos == NULL || endPos == NULL)
+	{
+		return NULL;
+	}
+
+	if (reverseSearchContext == NULL)
+	{
+		reverseSearchContext = new SearchContext(grid->getGridWidth() * grid->getGridHeight());
+	}
+
+	vector<Vector2i> positions;
+	if (findBidirectionalPath(*startPos, *endPos, includeDiagonals, searchContext,
+			reverseSearchContext, &positions, stats) != PathStatus::FOUND)
+	{
+		return NULL;
+	}
+
+	// look up the node at every position of the path
+	vector<GridNode*>* path = new vector<GridNode*>();
+	path->reserve(positions.size());
+	for (int i = 0; i < positions.size(); i++)
+	{
+		path->push_back(grid->getValueAt(positions[i].x, positions[i].y));
+	}
+
+	return path;
+}
+
+/// <summary>
+/// Find the shortest path between two grid positions with two A* searches,
+/// one from the start and one backwards from the end. Each step expands the
+/// side with the smaller open list, so a side that is stuck in a dead end
+/// stops growing once the other side is cheaper to grow. Every time a side
+/// reaches a cell the other side has reached, the path through that cell
+/// is remembered if it is the shortest so far. The search stops as soon
+/// as either side can't find anything shorter, which proves that path is
+/// a shortest one.
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="forwardContext">scratch state for the search from the start,
+/// whose cancel flag stops the whole search</param>
+/// <param name="backwardContext">scratch state for the search from the end</param>
+/// <param name="path">filled with the grid positions of the path starting
+/// after the start and ending with the end if a path is found</param>
+/// <param name="stats">filled with the number of cells each side expanded</param>
+/// <returns>whether a path was found</returns>
+PathFinder::PathStatus PathFinder::findBidirectionalPath(Vector2i start, Vector2i end, bool includeDiagonals,
+	SearchContext *forwardContext, SearchContext *backwardContext,
+	vector<Vector2i> *path, BidirectionalStats *stats)
+{
+	stats->forwardExpanded = 0;
+	stats->backwardExpanded = 0;
+
+	if (!grid->validCoords(start.x, start.y) || !grid->validCoords(end.x, end.y))
+	{
+		return PathStatus::INVALID_ENDPOINTS;
+	}
+
+	int startId = grid->toIndex(start.x, start.y);
+	int endId = grid->toIndex(end.x, end.y);
+	if (startId == endId)
+	{
+		path->clear();
+		return PathStatus::FOUND;
+	}
+	// the backward search starts on the end, so it has to be passable
+	if (!isPassable(endId) || !isConnected(start, end, includeDiagonals))
+	{
+		return PathStatus::UNREACHABLE;
+	}
+
+	int cellCount = grid->getGridWidth() * grid->getGridHeight();
+	forwardContext->beginSearch(cellCount);
+	backwardContext->beginSearch(cellCount);
+	IndexedHeap<SearchContext::CostCompare>* forwardOpenList = forwardContext->getOpenList();
+	IndexedHeap<SearchContext::CostCompare>* backwardOpenList = backwardContext->getOpenList();
+
+	forwardContext->reach(startId, 0, getDistance(start, end), -1);
+	forwardOpenList->push(startId);
+	backwardContext->reach(endId, 0, getDistance(end, start), -1);
+	backwardOpenList->push(endId);
+
+	int bestCost = INT_MAX;
+	int meetingId = -1;
+	while (!forwardOpenList->isEmpty() && !backwardOpenList->isEmpty())
+	{
+		if (forwardContext->isCancelled())
+		{
+			return PathStatus::CANCELLED;
+		}
+
+		// every path not found yet costs at least the lowest fcost of each
+		// side, so once either side reaches the best cost it is optimal
+		if (forwardContext->getFCost(forwardOpenList->top()) >= bestCost
+			|| backwardContext->getFCost(backwardOpenList->top()) >= bestCost)
+		{
+			break;
+		}
+
+		if (forwardOpenList->size() <= backwardOpenList->size())
+		{
+			expandBidirectional(forwardContext, backwardContext, end, includeDiagonals, &bestCost, &meetingId);
+			stats->forwardExpanded++;
+		}
+		else
+		{
+			expandBidirectional(backwardContext, forwardContext, start, includeDiagonals, &bestCost, &meetingId);
+			stats->backwardExpanded++;
+		}
+	}
+
+	if (meetingId == -1)
+	{
+		return PathStatus::UNREACHABLE;
+	}
+
+	// the start half of the path, then walk the backward search's
+	// parents from the meeting cell to the end
+	retracePath(forwardContext, startId, meetingId, path);
+	int currId = meetingId;
+	while (currId != endId)
+	{
+		currId = backwardContext->getParent(currId);
+		path->push_back(grid->toCoords(currId));
+	}
+
+	return PathStatus::FOUND;
+}
+
+/// <summary>
+/// Expand the best open cell of one side of a bidirectional search and
+/// remember the shortest path through any cell both sides have reached
+/// </summary>
+/// <param name="context">the side to expand</param>
+/// <param name="otherContext">the other side</param>
+/// <param name="target">the cell this side is heading for, which is where
+/// the other side started</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="bestCost">the cost of the shortest path found so far</param>
+/// <param name="meetingId">the cell both sides of that path go through</param>
+void PathFinder::expandBidirectional(SearchContext *context, SearchContext *otherContext, Vector2i target,
+	bool includeDiagonals, int *bestCost, int *meetingId)
+{
+	IndexedHeap<SearchContext::CostCompare>* openList = context->getOpenList();
+	int currId = openList->pop();
+	context->close(currId);
+
+	Vector2i currPos = grid->toCoords(currId);
+	int directions = neighbourDirections(includeDiagonals);
+	int neighbours = occupancy->getPassableNeighbours(currPos.x, currPos.y) & directions;
+	// paths can leave an occupied start, so the backward side
+	// may step onto its target even if it is occupied
+	int targetDx = target.x - currPos.x;
+	int targetDy = target.y - currPos.y;
+	if (abs(targetDx) <= 1 && abs(targetDy) <= 1 && (targetDx != 0 || targetDy != 0))
+	{
+		neighbours |= (1 << neighbourIndex(targetDx, targetDy)) & directions;
+	}
+
+	while (neighbours != 0)
+	{
+		int neighbour = popNeighbour(&neighbours);
+		Vector2i neighbourPos(currPos.x + NEIGHBOUR_X_OFFSETS[neighbour],
+			currPos.y + NEIGHBOUR_Y_OFFSETS[neighbour]);
+		int neighbourId = grid->toIndex(neighbourPos.x, neighbourPos.y);
+		bool isReached = context->isReached(neighbourId);
+		if (isReached && context->isClosed(neighbourId))
+		{
+			continue;
+		}
+
+		int newCost = context->getGCost(currId) + getDistance(currPos, neighbourPos);
+		if (!isReached)
+		{
+			context->reach(neighbourId, newCost, getDistance(neighbourPos, target), currId);
+			openList->push(neighbourId);
+		}
+		else if (newCost < context->getGCost(neighbourId))
+		{
+			context->setGCost(neighbourId, newCost, currId);
+			openList->decreaseKey(neighbourId);
+		}
+		else
+		{
+			continue;
+		}
+
+		// the two sides meet here
+		if (otherContext->isReached(neighbourId)
+			&& newCost + otherContext->getGCost(neighbourId) < *bestCost)
+		{
+			*bestCost = newCost + otherContext->getGCost(neighbourId);
+			*meetingId = neighbourId;
+		}
+	}
+}
+
+/// <summary>
+/// Find a path between two grid positions that can head in any direction
+/// rather than only to the 8 neighbours, with Lazy Theta*. The search
+/// expands cells like A*, but a cell reached from another takes that
+/// cell's parent as its own, so paths are straight lines between the
+/// corners of obstacles. Line of sight between a cell and its parent is
+/// only checked when the cell is expanded, not when it is reached, which
+/// takes about one check per expanded cell. If the check fails, the cell
+/// goes back to the cheapest expanded neighbour as its parent.
+///
+/// Costs are Euclidean lengths in the units of getDistance, and the
+/// estimate is the straight line to the end. The paths are usually a few
+/// percent shorter than 8-neighbour paths and close to the true shortest
+/// paths among the obstacles, though neither is guaranteed.
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="context">scratch state for the search, reused across calls</param>
+/// <param name="waypoints">filled with the grid positions where the path
+/// turns, starting after the start and ending with the end, if a path is
+/// found. Consecutive waypoints are joined by straight lines with line of sight.</param>
+/// <param name="stats">filled with the work the search did, NULL if not needed</param>
+/// <returns>whether a path was found</returns>
+PathFinder::PathStatus PathFinder::findAnyAnglePath(Vector2i start, Vector2i end, SearchContext *context,
+	vector<Vector2i> *waypoints, AnyAngleStats *stats)
+{
+	waypoints->clear();
+	if (stats != NULL)
+	{
+		stats->expanded = 0;
+		stats->lineOfSightChecks = 0;
+	}
+	if (!grid->validCoords(start.x, start.y) || !grid->validCoords(end.x, end.y))
+	{
+		return PathStatus::INVALID_ENDPOINTS;
+	}
+	if (!isConnected(start, end, true))
+	{
+		return PathStatus::UNREACHABLE;
+	}
+
+	int gridWidth = grid->getGridWidth();
+	int startId = grid->toIndex(start.x, start.y);
+	int endId = grid->toIndex(end.x, end.y);
+	int lineOfSightChecks = 0;
+
+	context->beginSearch(gridWidth * grid->getGridHeight());
+	IndexedHeap<SearchContext::CostCompare>* openList = context->getOpenList();
+	context->reach(startId, 0, getStraightLineCost(start, end), -1);
+	openList->push(startId);
+
+	PathStatus status = PathStatus::UNREACHABLE;
+	while (!openList->isEmpty())
+	{
+		if (context->isCancelled())
+		{
+			status = PathStatus::CANCELLED;
+			break;
+		}
+
+		int currId = openList->pop();
+		Vector2i currPos = grid->toCoords(currId);
+		int parentId = context->getParent(currId);
+		// the parent was only assumed to be visible when the cell was reached
+		if (parentId != -1)
+		{
+			lineOfSightChecks++;
+			if (!hasLineOfSight(grid->toCoords(parentId), currPos))
+			{
+				int gCost;
+				parentId = findCheapestClosedNeighbour(context, currId, &gCost);
+				context->replaceParent(currId, gCost, parentId);
+			}
+		}
+		context->close(currId);
+		if (currId == endId)
+		{
+			status = PathStatus::FOUND;
+			break;
+		}
+
+		// the neighbours are offered this cell's parent, or this cell for the start
+		int sourceId = parentId == -1 ? currId : parentId;
+		Vector2i sourcePos = grid->toCoords(sourceId);
+		int sourceCost = context->getGCost(sourceId);
+		int neighbours = occupancy->getPassableNeighbours(currPos.x, currPos.y);
+		while (neighbours != 0)
+		{
+			int neighbour = popNeighbour(&neighbours);
+			Vector2i neighbourPos(currPos.x + NEIGHBOUR_X_OFFSETS[neighbour], currPos.y + NEIGHBOUR_Y_OFFSETS[neighbour]);
+			int neighbourId = neighbourPos.y * gridWidth + neighbourPos.x;
+			bool isReached = context->isReached(neighbourId);
+			if (isReached && context->isClosed(neighbourId))
+			{
+				continue;
+			}
+
+			int newCost = sourceCost + getStraightLineCost(sourcePos, neighbourPos);
+			if (!isReached)
+			{
+				context->reach(neighbourId, newCost, getStraightLineCost(neighbourPos, end), sourceId);
+				openList->push(neighbourId);
+			}
+			else if (newCost < context->getGCost(neighbourId))
+			{
+				context->setGCost(neighbourId, newCost, sourceId);
+				openList->decreaseKey(neighbourId);
+			}
+		}
+	}
+
+	if (stats != NULL)
+	{
+		stats->expanded = context->getExpandedCount();
+		stats->lineOfSightChecks = lineOfSightChecks;
+	}
+	if (status != PathStatus::FOUND)
+	{
+		return status;
+	}
+
+	// the parents are the waypoints, from the end back
+	for (int currId = endId; currId != startId; currId = context->getParent(currId))
+	{
+		waypoints->push_back(grid->toCoords(currId));
+	}
+	reverse(waypoints->begin(), waypoints->end());
+	return status;
+}
+
+/// <summary>
+/// Find the expanded neighbour of a cell that reaches it the cheapest,
+/// for a cell that turned out not to see the parent it was given. There
+/// is always one, since the cell was reached from an expanded neighbour.
+/// </summary>
+/// <param name="context">the context of an any-angle search</param>
+/// <param name="id">the id of the cell</param>
+/// <param name="gCost">set to the distance of the cell from the start through the neighbour</param>
+/// <returns>the id of the neighbour</returns>
+int PathFinder::findCheapestClosedNeighbour(SearchContext *context, int id, int *gCost)
+{
+	int gridWidth = grid->getGridWidth();
+	int x = id % gridWidth;
+	int y = id / gridWidth;
+	int bestId = -1;
+	*gCost = INT_MAX;
+	int neighbours = occupancy->getPassableNeighbours(x, y);
+	while (neighbours != 0)
+	{
+		int neighbour = popNeighbour(&neighbours);
+		int neighbourId = id + NEIGHBOUR_Y_OFFSETS[neighbour] * gridWidth + NEIGHBOUR_X_OFFSETS[neighbour];
+		if (!context->isReached(neighbourId) || !context->isClosed(neighbourId))
+		{
+			continue;
+		}
+		int cost = context->getGCost(neighbourId) + OctileCosts::moveCost(neighbour);
+		if (cost < *gCost)
+		{
+			*gCost = cost;
+			bestId = neighbourId;
+		}
+	}
+	return bestId;
+}
+
+/// <summary>
+/// Find the shortest path between two valid grid positions with Jump
+/// Point Search. Instead of adding every neighbour to the open list, each
+/// direction is followed in a straight line until reaching a cell where a
+/// shortest path may have to turn (a jump point). Only jump points are
+/// added to the open list, which skips the many equally short paths that
+/// A* would otherwise expand on open areas. Moves cost the same as in
+/// findAStarPath, so the paths found have the same cost.
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="context">scratch state for the search, left with the
+/// jump points of the path as parents if one is found</param>
+/// <returns>whether a path was found</returns>
+PathFinder::PathStatus PathFinder::findJumpPointPath(Vector2i start, Vector2i end, bool includeDiagonals,
+	SearchContext *context)
+{
+	int startId = grid->toIndex(start.x, start.y);
+	int endId = grid->toIndex(end.x, end.y);
+
+	context->beginSearch(grid->getGridWidth() * grid->getGridHeight());
+	IndexedHeap<SearchContext::CostCompare>* openList = context->getOpenList();
+
+	context->reach(startId, 0, getDistance(start, end), -1);
+	openList->push(startId);
+
+	while (!openList->isEmpty())
+	{
+		if (context->isCancelled())
+		{
+			return PathStatus::CANCELLED;
+		}
+
+		int currId = openList->pop();
+		context->close(currId);
+
+		if (currId == endId)
+		{
+			return PathStatus::FOUND;
+		}
+
+		Vector2i currPos = grid->toCoords(currId);
+		int x = currPos.x;
+		int y = currPos.y;
+
+		// find the directions worth following from this cell. Going back
+		// towards the parent or sideways into open cells can't be part of
+		// a shorter path than the ones through the parent, so those are pruned
+		Vector2i directions[8];
+		int numDirections = 0;
+		int parentId = context->getParent(currId);
+		if (parentId == -1)
+		{
+			// the start cell goes every way
+			int startDirections = neighbourDirections(includeDiagonals);
+			while (startDirections != 0)
+			{
+				int neighbour = popNeighbour(&startDirections);
+				directions[numDirections++] = Vector2i(NEIGHBOUR_X_OFFSETS[neighbour], NEIGHBOUR_Y_OFFSETS[neighbour]);
+			}
+		}
+		else
+		{
+			Vector2i parentPos = grid->toCoords(parentId);
+			int dx = (x > parentPos.x) - (x < parentPos.x);
+			int dy = (y > parentPos.y) - (y < parentPos.y);
+
+			// keep going the same way, plus the turns forced by obstacles
+			if (includeDiagonals && dx != 0 && dy != 0)
+			{
+				directions[numDirections++] = Vector2i(0, dy);
+				directions[numDirections++] = Vector2i(dx, 0);
+				directions[numDirections++] = Vector2i(dx, dy);
+				if (!isWalkable(x - dx, y))
+				{
+					directions[numDirections++] = Vector2i(-dx, dy);
+				}
+				if (!isWalkable(x, y - dy))
+				{
+					directions[numDirections++] = Vector2i(dx, -dy);
+				}
+			}
+			else if (includeDiagonals && dx == 0)
+			{
+				directions[numDirections++] = Vector2i(0, dy);
+				if (!isWalkable(x + 1, y))
+				{
+					directions[numDirections++] = Vector2i(1, dy);
+				}
+				if (!isWalkable(x - 1, y))
+				{
+					directions[numDirections++] = Vector2i(-1, dy);
+				}
+			}
+			else if (includeDiagonals)
+			{
+				directions[numDirections++] = Vector2i(dx, 0);
+				if (!isWalkable(x, y + 1))
+				{
+					directions[numDirections++] = Vector2i(dx, 1);
+				}
+				if (!isWalkable(x, y - 1))
+				{
+					directions[numDirections++] = Vector2i(dx, -1);
+				}
+			}
+			else if (dx != 0)
+			{
+				// without diagonals a jump point can always turn
+				// either way, as the turns are what make it a jump point
+				directions[numDirections++] = Vector2i(dx, 0);
+				directions[numDirections++] = Vector2i(0, 1);
+				directions[numDirections++] = Vector2i(0, -1);
+			}
+			else
+			{
+				directions[numDirections++] = Vector2i(0, dy);
+				directions[numDirections++] = Vector2i(1, 0);
+				directions[numDirections++] = Vector2i(-1, 0);
+			}
+		}
+
+		// jump in every direction and add the jump points found
+		for (int i = 0; i < numDirections; i++)
+		{
+			int dx = directions[i].x;
+			int dy = directions[i].y;
+			int jumpId = jump(x + dx, y + dy, dx, dy, end, includeDiagonals);
+			if (jumpId == -1)
+			{
+				continue;
+			}
+
+			bool isReached = context->isReached(jumpId);
+			if (isReached && context->isClosed(jumpId))
+			{
+				continue;
+			}
+
+			// jumps go in a straight or diagonal line so the octile
+			// distance is the exact cost of the jump
+			Vector2i jumpPos = grid->toCoords(jumpId);
+			int newCost = context->getGCost(currId) + getDistance(currPos, jumpPos);
+			if (!isReached)
+			{
+				context->reach(jumpId, newCost, getDistance(jumpPos, end), currId);
+				openList->push(jumpId);
+			}
+			else if (newCost < context->getGCost(jumpId))
+			{
+				context->setGCost(jumpId, newCost, currId);
+				openList->decreaseKey(jumpId);
+			}
+		}
+	}
+
+	return PathStatus::UNREACHABLE;
+}
+
+/// <summary>
+/// Walk from the given cell in the given direction until reaching
+/// a jump point: the end cell, or a cell next to an obstacle that makes
+/// turning there possibly shorter than any other way around it
+/// </summary>
+/// <param name="x">the x coordinate of the first cell of the walk</param>
+/// <param name="y">the y coordinate of the first cell of the walk</param>
+/// <param name="dx">the x direction of the walk, -1, 0 or 1</param>
+/// <param name="dy">the y direction of the walk, -1, 0 or 1</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <returns>the id of the jump point, or -1 if the walk hits an obstacle
+/// or the edge of the grid first</returns>
+int PathFinder::jump(int x, int y, int dx, int dy, Vector2i end, bool includeDiagonals)
+{
+	if (dy == 0)
+	{
+		return jumpHorizontal(x, y, dx, end, includeDiagonals);
+	}
+
+	while (isWalkable(x, y))
+	{
+		if (x == end.x && y == end.y)
+		{
+			return grid->toIndex(x, y);
+		}
+
+		if (dx != 0 && dy != 0)
+		{
+			// a blocked cell behind the walk opens up a diagonal that
+			// can only be reached from here
+			if ((isWalkable(x - dx, y + dy) && !isWalkable(x - dx, y))
+				|| (isWalkable(x + dx, y - dy) && !isWalkable(x, y - dy)))
+			{
+				return grid->toIndex(x, y);
+			}
+			// a diagonal walk stops where a straight walk would find a jump point
+			if (jump(x + dx, y, dx, 0, end, includeDiagonals) != -1
+				|| jump(x, y + dy, 0, dy, end, includeDiagonals) != -1)
+			{
+				return grid->toIndex(x, y);
+			}
+		}
+		else if (includeDiagonals)
+		{
+			// a blocked cell beside the walk opens up a diagonal
+			// that can only be reached from here
+			if ((isWalkable(x + 1, y + dy) && !isWalkable(x + 1, y))
+				|| (isWalkable(x - 1, y + dy) && !isWalkable(x - 1, y)))
+			{
+				return grid->toIndex(x, y);
+			}
+		}
+		else
+		{
+			if ((isWalkable(x - 1, y) && !isWalkable(x - 1, y - dy))
+				|| (isWalkable(x + 1, y) && !isWalkable(x + 1, y - dy)))
+			{
+				return grid->toIndex(x, y);
+			}
+			// a vertical walk stops where a horizontal walk would find a jump point
+			if (jump(x + 1, y, 1, 0, end, includeDiagonals) != -1
+				|| jump(x - 1, y, -1, 0, end, includeDiagonals) != -1)
+			{
+				return grid->toIndex(x, y);
+			}
+		}
+
+		x += dx;
+		y += dy;
+	}
+
+	return -1;
+}
+
+/// <summary>
+/// Walk along a row like jump does, 64 cells at a time. The cells of the
+/// row and of the rows above and below are read as words of occupancy
+/// bits, and the first blocked cell and the first cell where a turn is
+/// forced are found with bit scans instead of testing every cell.
+/// </summary>
+/// <param name="x">the x coordinate of the first cell of the walk</param>
+/// <param name="y">the y coordinate of the row</param>
+/// <param name="dx">the direction of the walk, -1 or 1</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <returns>the id of the jump point, or -1 if the walk hits an obstacle
+/// or the edge of the grid first</returns>
+int PathFinder::jumpHorizontal(int x, int y, int dx, Vector2i end, bool includeDiagonals)
+{
+	const int CHUNK = 64;
+	while (true)
+	{
+		// read the chunk so that bit i is the i-th cell of the walk when
+		// going right, and bit 63 - i is when going left. Ahead and behind
+		// are the same rows one cell further along or back.
+		int first = dx > 0 ? x : x - (CHUNK - 1);
+		uint64_t blocked = occupancy->getRowBits(first, y, CHUNK);
+		uint64_t above = occupancy->getRowBits(first, y - 1, CHUNK);
+		uint64_t below = occupancy->getRowBits(first, y + 1, CHUNK);
+		uint64_t stops;
+		if (includeDiagonals)
+		{
+			// a blocked side cell with an open cell ahead of it
+			uint64_t aboveAhead = occupancy->getRowBits(first + dx, y - 1, CHUNK);
+			uint64_t belowAhead = occupancy->getRowBits(first + dx, y + 1, CHUNK);
+			stops = (above & ~aboveAhead) | (below & ~belowAhead);
+		}
+		else
+		{
+			// an open side cell with a blocked cell behind it
+			uint64_t aboveBehind = occupancy->getRowBits(first - dx, y - 1, CHUNK);
+			uint64_t belowBehind = occupancy->getRowBits(first - dx, y + 1, CHUNK);
+			stops = (~above & aboveBehind) | (~below & belowBehind);
+		}
+		if (end.y == y && end.x >= first && end.x < first + CHUNK)
+		{
+			stops |= (uint64_t)1 << (end.x - first);
+		}
+
+		if (dx > 0)
+		{
+			// the walk ends at the first blocked cell
+			int blockedAt = blocked != 0 ? OccupancyGrid::lowestBit(blocked) : CHUNK;
+			stops &= OccupancyGrid::lowBitsMask(blockedAt);
+			if (stops != 0)
+			{
+				return grid->toIndex(first + OccupancyGrid::lowestBit(stops), y);
+			}
+		}
+		else
+		{
+			int blockedAt = blocked != 0 ? OccupancyGrid::highestBit(blocked) : -1;
+			stops &= ~OccupancyGrid::lowBitsMask(blockedAt + 1);
+			if (stops != 0)
+			{
+				return grid->toIndex(first + OccupancyGrid::highestBit(stops), y);
+			}
+		}
+
+		if (blocked != 0)
+		{
+			return -1;
+		}
+		x += dx * CHUNK;
+	}
+}
+
+/// <summary>
+/// Start an A* search that runs a slice at a time through stepPath, so
+/// many searches can share a fixed budget per frame. No cells are expanded
+/// until the first step. Every sliced search needs its own SlicedSearch.
+/// </summary>
+/// <param name="start">the grid position to start from</param>
+/// <param name="end">the grid position to reach</param>
+/// <param name="includeDiagonals">whether the path can move diagonally</param>
+/// <param name="search">the state of the search, reused across searches</param>
+/// <returns>IN_PROGRESS, or INVALID_ENDPOINTS if the start or end is outside of the grid</returns>
+PathFinder::PathStatus PathFinder::beginPath(Vector2i start, Vector2i end, bool includeDiagonals,
+	SlicedSearch *search)
+{
+	search->start = start;
+	search->end = end;
+	search->includeDiagonals = includeDiagonals;
+	search->revision = revision;
+	if (!grid->validCoords(start.x, start.y) || !grid->validCoords(end.x, end.y))
+	{
+		search->status = PathStatus::INVALID_ENDPOINTS;
+	}
+	else if (!isConnected(start, end, includeDiagonals))
+	{
+		search->status = PathStatus::UNREACHABLE;
+	}
+	else
+	{
+		search->status = findAStarPath(start, end, includeDiagonals, 0, &search->context, false, 0);
+	}
+	return search->status;
+}
+
+/// <summary>
+/// Carry on with a sliced search until it finishes or uses up its budget.
+/// If the grid has changed since the search began, it starts over so the
+/// path it finds is never stale.
+/// </summary>
+/// <param name="search">a search started by beginPath</param>
+/// <param name="maxExpansions">the most cells to expand in this step, at least 1</param>
+/// <param name="maxMicroseconds">the most time to spend in this step, 0 for no limit</param>
+/// <param name="path">filled with the grid positions of the path starting
+/// after the start and ending with the end if FOUND is returned</param>
+/// <returns>IN_PROGRESS if the budget ran out, otherwise whether a path was found</returns>
+PathFinder::PathStatus PathFinder::stepPath(SlicedSearch *search, int maxExpansions, int maxMicroseconds,
+	vector<Vector2i> *path)
+{
+	if (search->status == PathStatus::IN_PROGRESS && search->revision != revision)
+	{
+		beginPath(search->start, search->end, search->includeDiagonals, search);
+	}
+
+	// reading the clock costs about as much as an expansion, so a
+	// time limit is only checked every few expansions
+	const int CLOCK_CHECK_INTERVAL = 32;
+	auto stepStart = chrono::steady_clock::now();
+	maxExpansions = max(1, maxExpansions);
+	int expanded = 0;
+	while (search->status == PathStatus::IN_PROGRESS && expanded < maxExpansions)
+	{
+		int slice = maxExpansions - expanded;
+		if (maxMicroseconds > 0)
+		{
+			slice = min(slice, CLOCK_CHECK_INTERVAL);
+		}
+		search->status = findAStarPath(search->start, search->end, search->includeDiagonals, 0,
+			&search->context, true, slice);
+		expanded += slice;
+
+		if (maxMicroseconds > 0 && chrono::duration_cast<chrono::microseconds>(
+			chrono::steady_clock::now() - stepStart).count() >= maxMicroseconds)
+		{
+			break;
+		}
+	}
+
+	if (search->status == PathStatus::FOUND)
+	{
+		retracePath(&search->context, grid->toIndex(search->start.x, search->start.y),
+			grid->toIndex(search->end.x, search->end.y), path);
+	}
+	return search->status;
+}
+
+/// <summary>
+/// Answer a batch of queries on the worker threads of the given pool.
+/// The grid must not change until this returns. Only one batch can run
+/// on a PathFinder at a time, but each worker reuses its search state from
+/// one batch to the next.
+/// </summary>
+/// <param name="queries">the queries to answer</param>
+/// <param name="numQueries">the number of queries</param>
+/// <param name="pool">the threads to spread the queries over</param>
+/// <param name="result">filled with the status of every query and the
+/// paths found, each one starting after its start position and ending with
+/// its end position</param>
+void PathFinder::findPaths(const PathQuery *queries, int numQueries, ThreadPool *pool, BatchPathResult *result)
+{
+	int numWorkers = pool->getThreadCount();
+	while (batchWorkers.size() < numWorkers)
+	{
+		batchWorkers.push_back(new BatchWorker());
+	}
+	for (int i = 0; i < numWorkers; i++)
+	{
+		batchWorkers[i]->paths.clear();
+	}
+
+	// every worker appends its paths to its own buffer and
+	// records where they went, so they can be gathered afterwards
+	vector<PathQueryResult>& results = result->results;
+	vector<int> resultWorker(numQueries);
+	results.resize(numQueries);
+
+	// several small chunks per worker so the stealing can balance the load
+	int chunkSize = max(1, numQueries / (numWorkers * 8));
+	pool->parallelFor(numQueries, chunkSize, [&](int begin, int end, int worker)
+	{
+		BatchWorker* batchWorker = batchWorkers[worker];
+		for (int i = begin; i < end; i++)
+		{
+			const PathQuery& query = queries[i];
+			PathQueryResult& queryResult = results[i];
+			queryResult.status = findPath(query.start, query.end, query.includeDiagonals,
+				&batchWorker->context, &batchWorker->path);
+			queryResult.pathOffset = (int)batchWorker->paths.size();
+			queryResult.pathLength = 0;
+			if (queryResult.status == PathStatus::FOUND)
+			{
+				queryResult.pathLength = (int)batchWorker->path.size();
+				batchWorker->paths.insert(batchWorker->paths.end(),
+					batchWorker->path.begin(), batchWorker->path.end());
+			}
+			resultWorker[i] = worker;
+		}
+	});
+
+	// gather the paths into one buffer in query order
+	size_t totalLength = 0;
+	for (int i = 0; i < numWorkers; i++)
+	{
+		totalLength += batchWorkers[i]->paths.size();
+	}
+	result->paths.resize(totalLength);
+
+	int offset = 0;
+	for (int i = 0; i < numQueries; i++)
+	{
+		PathQueryResult& queryResult = results[i];
+		vector<Vector2i>& workerPaths = batchWorkers[resultWorker[i]]->paths;
+		copy(workerPaths.begin() + queryResult.pathOffset,
+			workerPaths.begin() + queryResult.pathOffset + queryResult.pathLength,
+			result->paths.begin() + offset);
+		queryResult.pathOffset = offset;
+		offset += queryResult.pathLength;
+	}
+}
+
+bool PathFinder::drawShortestPath(RenderWindow* window, bool includeDiagonals)
+{
+	// only find shortest path if a start and end exist
+	if (startPos == NULL || endPos == NULL)
+	{
+		return false;
+	}
+
+	if (findPath(*startPos, *endPos, includeDiagonals, searchContext, &lastPath) != PathStatus::FOUND)
+	{
+		return false;
+	}
+
+	drawPath(window, &lastPath);
+	return true;
+}
+
+/// <summary>
+/// Draw a path found by any of the path finders in the given window
+/// </summary>
+/// <param name="window">window to draw into</param>
+/// <param name="path">the grid positions of the path</param>
+void PathFinder::drawPath(RenderWindow* window, const vector<Vector2i> *path)
+{
+	int cellSize = grid->getCellSize();
+	Color pathColor = Color::Green;
+
+	// draw the path
+	for (int i = 0; i < path->size(); i++)
+	{
+		Vector2i currPos = (*path)[i];
 
 		RectangleShape square(Vector2f(cellSize, cellSize));
 		Vector2f pos = grid->gridToScreen(currPos.x, currPos.y);
@@ -458,9 +2485,6 @@ bool PathFinder::drawShortestPath(RenderWindow* window, bool includeDiagonals)
 
 		window->draw(square);
 	}
-
-	delete(path);
-	return true;
 }
 
 
@@ -0,0 +1,438 @@
+#ifndef SEARCH_CONTEXT_H
+#define SEARCH_CONTEXT_H
+
+#include "IndexedHeap.hpp"
+#include "BucketQueue.hpp"
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <atomic>
+#ifdef PATH_FINDER_TRACE
+#include <fstream>
+#include <string>
+#endif
+
+using namespace std;
+
+/// <summary>
+/// Scratch state for one path search at a time: the costs, parents and
+/// open/closed state of every cell, plus the open list.
+///
+/// A cell's entries are only valid if the cell was reached during the
+/// current search, which is tracked with a generation stamp per cell.
+/// Starting a new search just bumps the generation, so a context can be
+/// reused for any number of searches without clearing or reallocating.
+/// Each thread searching the same grid needs its own context.
+///
+/// The context also counts the work of the current search for QueryStats.
+/// Defining PATH_FINDER_TRACE before including it also records the order
+/// cells are expanded in, which writeTrace saves for offline analysis;
+/// without it the trace costs nothing.
+/// </summary>
+class SearchContext
+{
+public:
+	// orders cell ids in the open list by lowest fcost, then lowest hcost,
+	// then the cell reached last, which is the cell a scan of the open list
+	// in the order cells were added would pick
+	struct CostCompare
+	{
+		SearchContext *context;
+
+		bool operator() (int id1, int id2) const
+		{
+			int fCost1 = context->gCosts[id1] + context->hCosts[id1];
+			int fCost2 = context->gCosts[id2] + context->hCosts[id2];
+			if (fCost1 != fCost2)
+			{
+				return fCost1 < fCost2;
+			}
+			if (context->hCosts[id1] != context->hCosts[id2])
+			{
+				return context->hCosts[id1] < context->hCosts[id2];
+			}
+			return context->reachOrders[id1] > context->reachOrders[id2];
+		}
+	};
+
+private:
+	unsigned int generation; // stamp of the current search
+	vector<unsigned int> stamps; // search in which each cell was last reached
+	vector<unsigned char> closed; // whether each cell has been picked for a path
+	vector<int> gCosts; // distance of each cell from the start
+	vector<int> hCosts; // estimated distance of each cell from the end
+	vector<int> parents; // id of the cell that came before each cell
+	vector<unsigned int> reachOrders; // position of each cell in the order cells were reached
+	unsigned int reachCount; // cells reached since the search began, for the next order
+	IndexedHeap<CostCompare> openList; // ids of the cells that CAN be part of the path
+	BucketQueue bucketQueue; // open list of searches keyed by small integer costs
+	int expandedCount; // cells closed during the current search
+	int generatedCount; // cells reached during the current search
+	int reopenedCount; // times a reached open cell's cost went down
+	int openPeak; // most cells reached but not closed at once
+	const atomic<bool> *cancelFlag; // stops the searches using this context once set, NULL if none
+#ifdef PATH_FINDER_TRACE
+	vector<int> trace; // ids of the cells closed, in order
+#endif
+
+public:
+	SearchContext();
+
+	SearchContext(int cellCount);
+
+	void beginSearch(int cellCount);
+
+	bool isReached(int id);
+
+	void reach(int id, int gCost, int hCost, int parent);
+
+	bool isClosed(int id);
+
+	void close(int id);
+
+	int getGCost(int id);
+
+	int getHCost(int id);
+
+	int getFCost(int id);
+
+	int getParent(int id);
+
+	void setGCost(int id, int gCost, int parent);
+
+	void replaceParent(int id, int gCost, int parent);
+
+	IndexedHeap<CostCompare> *getOpenList();
+
+	BucketQueue *getBucketQueue();
+
+	int getExpandedCount();
+
+	int getGeneratedCount();
+
+	int getReopenedCount();
+
+	int getOpenPeak();
+
+	void resetCounts();
+
+#ifdef PATH_FINDER_TRACE
+	const vector<int> *getTrace();
+
+	bool writeTrace(const string &fileName, int gridWidth);
+#endif
+
+	void setCancelFlag(const atomic<bool> *flag);
+
+	bool isCancelled();
+
+private:
+	// every context owns an open list that points back at it
+	SearchContext(const SearchContext &other) = delete;
+
+	SearchContext &operator = (const SearchContext &other) = delete;
+};
+
+/// <summary>
+/// Create a context with no storage. Storage is added by the first search.
+/// </summary>
+SearchContext::SearchContext()
+	: openList(0, CostCompare{ this })
+{
+	generation = 0;
+	reachCount = 0;
+	cancelFlag = NULL;
+	resetCounts();
+}
+
+/// <summary>
+/// Create a context with room for grids with the given number of cells
+/// </summary>
+/// <param name="cellCount">the number of cells in the grid to search</param>
+SearchContext::SearchContext(int cellCount)
+	: openList(0, CostCompare{ this })
+{
+	generation = 0;
+	cancelFlag = NULL;
+	beginSearch(cellCount);
+}
+
+/// <summary>
+/// Forget the previous search and get ready for a new one
+/// </summary>
+/// <param name="cellCount">the number of cells in the grid to search</param>
+void SearchContext::beginSearch(int cellCount)
+{
+	openList.clear();
+	resetCounts();
+	reachCount = 0;
+
+	// only grow the storage, smaller grids can use a prefix of it
+	if ((int)stamps.size() < cellCount)
+	{
+		stamps.assign(cellCount, 0);
+		closed.assign(cellCount, 0);
+		gCosts.resize(cellCount);
+		hCosts.resize(cellCount);
+		parents.resize(cellCount);
+		reachOrders.resize(cellCount);
+		openList.setCapacity(cellCount);
+		generation = 0;
+	}
+
+	generation++;
+	// start over once the stamps wrap around so old stamps can't match
+	if (generation == UINT_MAX)
+	{
+		stamps.assign(stamps.size(), 0);
+		generation = 1;
+	}
+}
+
+/// <summary>
+/// Check if a cell has been reached during the current search
+/// </summary>
+/// <param name="id">the id of a cell</param>
+/// <returns>true if the cell has been reached and false otherwise</returns>
+bool SearchContext::isReached(int id)
+{
+	return stamps[id] == generation;
+}
+
+/// <summary>
+/// Mark a cell as reached during the current search and set its costs
+/// </summary>
+/// <param name="id">the id of a cell</param>
+/// <param name="gCost">the distance of the cell from the start</param>
+/// <param name="hCost">the estimated distance of the cell from the end</param>
+/// <param name="parent">the id of the cell that came before it, -1 if none</param>
+void SearchContext::reach(int id, int gCost, int hCost, int parent)
+{
+	stamps[id] = generation;
+	closed[id] = 0;
+	generatedCount++;
+	reachOrders[id] = reachCount++;
+	gCosts[id] = gCost;
+	hCosts[id] = hCost;
+	parents[id] = parent;
+}
+
+/// <summary>
+/// Check if a reached cell has been picked for a path
+/// </summary>
+/// <param name="id">the id of a reached cell</param>
+/// <returns>true if the cell is closed and false otherwise</returns>
+bool SearchContext::isClosed(int id)
+{
+	return closed[id] != 0;
+}
+
+/// <summary>
+/// Mark a reached cell as picked for a path
+/// </summary>
+/// <param name="id">the id of a reached cell</param>
+void SearchContext::close(int id)
+{
+	// every reached cell that isn't closed yet is in the open list
+	openPeak = max(openPeak, generatedCount - expandedCount);
+	closed[id] = 1;
+	expandedCount++;
+#ifdef PATH_FINDER_TRACE
+	trace.push_back(id);
+#endif
+}
+
+/// <summary>
+/// Get the distance of a reached cell from the start
+/// </summary>
+/// <param name="id">the id of a reached cell</param>
+/// <returns>the g cost of the cell</returns>
+int SearchContext::getGCost(int id)
+{
+	return gCosts[id];
+}
+
+/// <summary>
+/// Get the estimated distance of a reached cell from the end
+/// </summary>
+/// <param name="id">the id of a reached cell</param>
+/// <returns>the h cost of the cell</returns>
+int SearchContext::getHCost(int id)
+{
+	return hCosts[id];
+}
+
+/// <summary>
+/// Get the estimated length of the path through a reached cell
+/// </summary>
+/// <param name="id">the id of a reached cell</param>
+/// <returns>the f cost of the cell</returns>
+int SearchContext::getFCost(int id)
+{
+	return gCosts[id] + hCosts[id];
+}
+
+/// <summary>
+/// Get the cell that came before a reached cell in the path
+/// </summary>
+/// <param name="id">the id of a reached cell</param>
+/// <returns>the id of the parent cell, or -1 for the start</returns>
+int SearchContext::getParent(int id)
+{
+	return parents[id];
+}
+
+/// <summary>
+/// Give a reached cell a shorter distance from the start
+/// </summary>
+/// <param name="id">the id of a reached cell</param>
+/// <param name="gCost">the new distance of the cell from the start</param>
+/// <param name="parent">the id of the cell that now comes before it</param>
+void SearchContext::setGCost(int id, int gCost, int parent)
+{
+	gCosts[id] = gCost;
+	parents[id] = parent;
+	reopenedCount++;
+}
+
+/// <summary>
+/// Give a closed cell another parent and the cost through it, for searches
+/// that guess a parent and check it once the cell is picked. Unlike
+/// setGCost this doesn't count as reopening the cell.
+/// </summary>
+/// <param name="id">the id of a reached cell</param>
+/// <param name="gCost">the distance of the cell from the start through the new parent</param>
+/// <param name="parent">the id of the cell that now comes before it</param>
+void SearchContext::replaceParent(int id, int gCost, int parent)
+{
+	gCosts[id] = gCost;
+	parents[id] = parent;
+}
+
+/// <summary>
+/// Get the open list of the current search
+/// </summary>
+/// <returns>the open list</returns>
+IndexedHeap<SearchContext::CostCompare> *SearchContext::getOpenList()
+{
+	return &openList;
+}
+
+/// <summary>
+/// Get the bucket queue used as the open list by searches whose costs are
+/// small integers. Those searches reset it themselves.
+/// </summary>
+/// <returns>the bucket queue</returns>
+BucketQueue *SearchContext::getBucketQueue()
+{
+	return &bucketQueue;
+}
+
+/// <summary>
+/// Get the number of cells closed during the current search, which is
+/// the number of cells the search expanded
+/// </summary>
+/// <returns>the number of expanded cells</returns>
+int SearchContext::getExpandedCount()
+{
+	return expandedCount;
+}
+
+/// <summary>
+/// Get the number of cells reached during the current search, which is
+/// the number of cells the search generated
+/// </summary>
+/// <returns>the number of generated cells</returns>
+int SearchContext::getGeneratedCount()
+{
+	return generatedCount;
+}
+
+/// <summary>
+/// Get the number of times a cell of the current search was reached again
+/// with a lower cost before it was closed, and put back in the open list
+/// at its new place
+/// </summary>
+/// <returns>the number of reopened cells</returns>
+int SearchContext::getReopenedCount()
+{
+	return reopenedCount;
+}
+
+/// <summary>
+/// Get the most cells the open list of the current search held at once
+/// </summary>
+/// <returns>the peak size of the open list</returns>
+int SearchContext::getOpenPeak()
+{
+	return openPeak;
+}
+
+/// <summary>
+/// Zero the work counted for the current search. beginSearch does this
+/// itself, so this is only needed when a query ends before searching.
+/// </summary>
+void SearchContext::resetCounts()
+{
+	expandedCount = 0;
+	generatedCount = 0;
+	reopenedCount = 0;
+	openPeak = 0;
+#ifdef PATH_FINDER_TRACE
+	trace.clear();
+#endif
+}
+
+#ifdef PATH_FINDER_TRACE
+/// <summary>
+/// Get the cells closed during the current search
+/// </summary>
+/// <returns>the ids of the cells in the order they were expanded</returns>
+const vector<int> *SearchContext::getTrace()
+{
+	return &trace;
+}
+
+/// <summary>
+/// Write the cells closed during the current search to a CSV file with
+/// one "order,x,y" line per cell
+/// </summary>
+/// <param name="fileName">the path of the file to write</param>
+/// <param name="gridWidth">the width of the grid searched, to turn ids into coordinates</param>
+/// <returns>true if the file was written and false otherwise</returns>
+bool SearchContext::writeTrace(const string &fileName, int gridWidth)
+{
+	ofstream out(fileName);
+	if (!out)
+	{
+		return false;
+	}
+	out << "order,x,y" << endl;
+	for (int i = 0; i < trace.size(); i++)
+	{
+		out << i << "," << trace[i] % gridWidth << "," << trace[i] / gridWidth << "\n";
+	}
+	return (bool)out;
+}
+#endif
+
+/// <summary>
+/// Give the context a flag that another thread can set to stop the
+/// searches using it early
+/// </summary>
+/// <param name="flag">the flag to watch, NULL to stop watching one</param>
+void SearchContext::setCancelFlag(const atomic<bool> *flag)
+{
+	cancelFlag = flag;
+}
+
+/// <summary>
+/// Check if the search using this context should stop early
+/// </summary>
+/// <returns>true if the cancel flag is set and false otherwise</returns>
+bool SearchContext::isCancelled()
+{
+	return cancelFlag != NULL && cancelFlag->load(memory_order_relaxed);
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef SEARCH_POLICIES_H
+#define SEARCH_POLICIES_H
+
+#include "Neighbours.hpp"
+#include <algorithm>
+
+using namespace std;
+
+// Policies the searches are compiled for. A search templated on a
+// connectivity (FourConnected or EightConnected from Neighbours.hpp), a
+// cost model and a heuristic gets all three as constants, so its inner
+// loop has no per-neighbour branches on them.
+
+/// <summary>
+/// Straight moves cost 10 and diagonal moves 14, roughly 1 and the square
+/// root of 2 in whole numbers
+/// </summary>
+struct OctileCosts
+{
+	typedef int Cost;
+	static const int STRAIGHT = 10;
+	static const int DIAGONAL = 14;
+
+	// cost of moving to the given neighbour of a cell
+	static int moveCost(int neighbour)
+	{
+		return NEIGHBOUR_IS_DIAGONAL[neighbour] ? DIAGONAL : STRAIGHT;
+	}
+};
+
+/// <summary>
+/// Estimate of the cost between two cells that only moves straight.
+/// Exact on open grids without diagonals, but overestimates when paths
+/// can move diagonally, which trades shortest paths for fewer expansions.
+/// </summary>
+template <typename Costs>
+struct ManhattanHeuristic
+{
+	static typename Costs::Cost estimate(int xDist, int yDist)
+	{
+		return Costs::STRAIGHT * (xDist + yDist);
+	}
+};
+
+/// <summary>
+/// Estimate of the cost between two cells that moves diagonally as far as
+/// it can. Exact on open grids with diagonals.
+/// </summary>
+template <typename Costs>
+struct OctileHeuristic
+{
+	static typename Costs::Cost estimate(int xDist, int yDist)
+	{
+		int numOfDiagonals = min(xDist, yDist);
+		return Costs::DIAGONAL * numOfDiagonals + Costs::STRAIGHT * (max(xDist, yDist) - numOfDiagonals);
+	}
+};
+
+/// <summary>
+/// Estimate of the cost between two cells as if diagonal moves cost the
+/// same as straight ones. Never overestimates, but is looser than octile.
+/// </summary>
+template <typename Costs>
+struct ChebyshevHeuristic
+{
+	static typename Costs::Cost estimate(int xDist, int yDist)
+	{
+		return Costs::STRAIGHT * max(xDist, yDist);
+	}
+};
+
+/// <summary>
+/// No estimate at all, which turns A* into Dijkstra's algorithm
+/// </summary>
+template <typename Costs>
+struct ZeroHeuristic
+{
+	static typename Costs::Cost estimate(int, int)
+	{
+		return 0;
+	}
+};
+
+#endif
@@ -0,0 +1,367 @@
+#ifndef SEARCH_STATISTICS_H
+#define SEARCH_STATISTICS_H
+
+#include <ostream>
+#include <algorithm>
+
+using namespace std;
+
+// number of buckets of a CountHistogram, enough for any long long
+const int HISTOGRAM_BUCKETS = 64;
+
+// how much work one path query did
+struct QueryStats
+{
+	bool found; // whether a path was found
+	int expanded; // cells taken out of the open list and closed
+	int generated; // cells reached and put in the open list for the first time
+	int openPeak; // most cells in the open list at once
+	int reopened; // reached cells whose cost went down before they were closed
+	int pathLength; // number of positions in the path, 0 if none was found
+	int pathCost; // cost of the path in move cost units, 0 if none was found
+	long long microseconds; // wall time of the query
+};
+
+/// <summary>
+/// Counts of non-negative values in buckets of powers of two: bucket 0
+/// holds the zeros and bucket i holds the values in [2^(i-1), 2^i), so any
+/// value fits in a fixed array and adding one is a few instructions.
+/// </summary>
+class CountHistogram
+{
+private:
+	long long counts[HISTOGRAM_BUCKETS]; // values in each bucket
+
+public:
+	CountHistogram();
+
+	void add(long long value);
+
+	void merge(const CountHistogram &other);
+
+	void clear();
+
+	long long getCount(int bucket) const;
+
+	static long long getBucketStart(int bucket);
+
+	long long getPercentile(double percent) const;
+
+	void print(ostream &out) const;
+};
+
+/// <summary>
+/// Totals and histograms of the QueryStats of many queries. Recording is
+/// not thread safe, so threads that search at once should keep one each
+/// and merge them afterwards.
+/// </summary>
+class SearchStatistics
+{
+private:
+	long long queries; // queries recorded
+	long long found; // queries that found a path
+	long long totalExpanded;
+	long long totalGenerated;
+	long long totalReopened;
+	long long totalMicroseconds;
+	int maxOpenPeak; // biggest open list of any query
+	CountHistogram expandedHistogram; // cells expanded per query
+	CountHistogram microsecondsHistogram; // wall time per query
+
+public:
+	SearchStatistics();
+
+	void record(const QueryStats &stats);
+
+	void merge(const SearchStatistics &other);
+
+	void clear();
+
+	long long getQueryCount() const;
+
+	long long getFoundCount() const;
+
+	long long getTotalExpanded() const;
+
+	long long getTotalGenerated() const;
+
+	long long getTotalReopened() const;
+
+	long long getTotalMicroseconds() const;
+
+	int getMaxOpenPeak() const;
+
+	const CountHistogram *getExpandedHistogram() const;
+
+	const CountHistogram *getMicrosecondsHistogram() const;
+
+	void print(ostream &out) const;
+};
+
+/// <summary>
+/// Create an empty histogram
+/// </summary>
+CountHistogram::CountHistogram()
+{
+	clear();
+}
+
+/// <summary>
+/// Count a value
+/// </summary>
+/// <param name="value">the value to count, negative values count as 0</param>
+void CountHistogram::add(long long value)
+{
+	int bucket = 0;
+	// the bucket is the number of bits needed to write the value
+	for (unsigned long long rest = (unsigned long long)max(value, 0LL); rest != 0; rest >>= 1)
+	{
+		bucket++;
+	}
+	counts[min(bucket, HISTOGRAM_BUCKETS - 1)]++;
+}
+
+/// <summary>
+/// Add the counts of another histogram to this one
+/// </summary>
+/// <param name="other">the histogram to add</param>
+void CountHistogram::merge(const CountHistogram &other)
+{
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		counts[i] += other.counts[i];
+	}
+}
+
+/// <summary>
+/// Forget every value counted
+/// </summary>
+void CountHistogram::clear()
+{
+	fill(counts, counts + HISTOGRAM_BUCKETS, 0LL);
+}
+
+/// <summary>
+/// Get the number of values in a bucket
+/// </summary>
+/// <param name="bucket">the index of a bucket</param>
+/// <returns>the number of values counted in the bucket</returns>
+long long CountHistogram::getCount(int bucket) const
+{
+	return counts[bucket];
+}
+
+/// <summary>
+/// Get the smallest value that goes in a bucket
+/// </summary>
+/// <param name="bucket">the index of a bucket</param>
+/// <returns>0 for the first bucket and 2^(bucket-1) for the others</returns>
+long long CountHistogram::getBucketStart(int bucket)
+{
+	return bucket == 0 ? 0 : 1LL << (bucket - 1);
+}
+
+/// <summary>
+/// Estimate a percentile of the values counted, by the nearest rank
+/// </summary>
+/// <param name="percent">the percentile, from 0 to 100</param>
+/// <returns>the start of the bucket the percentile falls in, 0 if nothing was counted</returns>
+long long CountHistogram::getPercentile(double percent) const
+{
+	long long total = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		total += counts[i];
+	}
+	long long rank = max(1LL, (long long)(percent / 100 * total + 0.5));
+	long long seen = 0;
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		seen += counts[i];
+		if (seen >= rank)
+		{
+			return getBucketStart(i);
+		}
+	}
+	return 0;
+}
+
+/// <summary>
+/// Write a line for every bucket that has values, like "    [64, 128) 12"
+/// </summary>
+/// <param name="out">the stream to write to</param>
+void CountHistogram::print(ostream &out) const
+{
+	for (int i = 0; i < HISTOGRAM_BUCKETS; i++)
+	{
+		if (counts[i] == 0)
+		{
+			continue;
+		}
+		out << "    [" << getBucketStart(i) << ", " << (i == 0 ? 1 : getBucketStart(i) * 2) << ") "
+			<< counts[i] << endl;
+	}
+}
+
+/// <summary>
+/// Create statistics with no queries recorded
+/// </summary>
+SearchStatistics::SearchStatistics()
+{
+	clear();
+}
+
+/// <summary>
+/// Add a query to the totals and histograms
+/// </summary>
+/// <param name="stats">the work the query did</param>
+void SearchStatistics::record(const QueryStats &stats)
+{
+	queries++;
+	if (stats.found)
+	{
+		found++;
+	}
+	totalExpanded += stats.expanded;
+	totalGenerated += stats.generated;
+	totalReopened += stats.reopened;
+	totalMicroseconds += stats.microseconds;
+	maxOpenPeak = max(maxOpenPeak, stats.openPeak);
+	expandedHistogram.add(stats.expanded);
+	microsecondsHistogram.add(stats.microseconds);
+}
+
+/// <summary>
+/// Add the queries recorded by other statistics to these
+/// </summary>
+/// <param name="other">the statistics to add</param>
+void SearchStatistics::merge(const SearchStatistics &other)
+{
+	queries += other.queries;
+	found += other.found;
+	totalExpanded += other.totalExpanded;
+	totalGenerated += other.totalGenerated;
+	totalReopened += other.totalReopened;
+	totalMicroseconds += other.totalMicroseconds;
+	maxOpenPeak = max(maxOpenPeak, other.maxOpenPeak);
+	expandedHistogram.merge(other.expandedHistogram);
+	microsecondsHistogram.merge(other.microsecondsHistogram);
+}
+
+/// <summary>
+/// Forget every query recorded
+/// </summary>
+void SearchStatistics::clear()
+{
+	queries = 0;
+	found = 0;
+	totalExpanded = 0;
+	totalGenerated = 0;
+	totalReopened = 0;
+	totalMicroseconds = 0;
+	maxOpenPeak = 0;
+	expandedHistogram.clear();
+	microsecondsHistogram.clear();
+}
+
+/// <summary>
+/// Get the number of queries recorded
+/// </summary>
+/// <returns>the number of queries</returns>
+long long SearchStatistics::getQueryCount() const
+{
+	return queries;
+}
+
+/// <summary>
+/// Get the number of queries recorded that found a path
+/// </summary>
+/// <returns>the number of queries that found a path</returns>
+long long SearchStatistics::getFoundCount() const
+{
+	return found;
+}
+
+/// <summary>
+/// Get the number of cells expanded by all the queries
+/// </summary>
+/// <returns>the total of the expanded counts</returns>
+long long SearchStatistics::getTotalExpanded() const
+{
+	return totalExpanded;
+}
+
+/// <summary>
+/// Get the number of cells generated by all the queries
+/// </summary>
+/// <returns>the total of the generated counts</returns>
+long long SearchStatistics::getTotalGenerated() const
+{
+	return totalGenerated;
+}
+
+/// <summary>
+/// Get the number of cells reopened by all the queries
+/// </summary>
+/// <returns>the total of the reopened counts</returns>
+long long SearchStatistics::getTotalReopened() const
+{
+	return totalReopened;
+}
+
+/// <summary>
+/// Get the wall time of all the queries
+/// </summary>
+/// <returns>the total time in microseconds</returns>
+long long SearchStatistics::getTotalMicroseconds() const
+{
+	return totalMicroseconds;
+}
+
+/// <summary>
+/// Get the biggest open list of any query
+/// </summary>
+/// <returns>the largest open list peak recorded</returns>
+int SearchStatistics::getMaxOpenPeak() const
+{
+	return maxOpenPeak;
+}
+
+/// <summary>
+/// Get the histogram of the cells expanded per query
+/// </summary>
+/// <returns>the histogram</returns>
+const CountHistogram *SearchStatistics::getExpandedHistogram() const
+{
+	return &expandedHistogram;
+}
+
+/// <summary>
+/// Get the histogram of the wall time per query in microseconds
+/// </summary>
+/// <returns>the histogram</returns>
+const CountHistogram *SearchStatistics::getMicrosecondsHistogram() const
+{
+	return &microsecondsHistogram;
+}
+
+/// <summary>
+/// Write a summary of the queries recorded
+/// </summary>
+/// <param name="out">the stream to write to</param>
+void SearchStatistics::print(ostream &out) const
+{
+	double divisor = queries > 0 ? (double)queries : 1;
+	out << "queries " << queries << ", found " << found << endl
+		<< "  expanded: mean " << totalExpanded / divisor << " total " << totalExpanded << endl
+		<< "  generated: mean " << totalGenerated / divisor << " total " << totalGenerated << endl
+		<< "  reopened: total " << totalReopened << endl
+		<< "  open list peak: max " << maxOpenPeak << endl
+		<< "  time us: mean " << totalMicroseconds / divisor << " total " << totalMicroseconds << endl
+		<< "  expanded per query:" << endl;
+	expandedHistogram.print(out);
+	out << "  us per query:" << endl;
+	microsecondsHistogram.print(out);
+}
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+
+using namespace std;
+
+/// <summary>
+/// A fixed set of worker threads that run submitted tasks. Every worker
+/// has its own task queue. A worker takes the newest task from its own
+/// queue and, once that is empty, steals the oldest task from another
+/// worker's queue so no worker sits idle while there is work left.
+/// Tasks are given the index of the worker running them so they can use
+/// per-worker state without locking.
+/// </summary>
+class ThreadPool
+{
+private:
+	// tasks waiting to be run by one worker
+	struct WorkQueue
+	{
+		mutex lock;
+		deque<function<void(int)>> tasks;
+	};
+
+	vector<thread> workers;
+	vector<WorkQueue*> queues; // one per worker
+	atomic<unsigned int> nextQueue; // queue that gets the next submitted task
+
+	mutex stateLock; // guards the counters below
+	condition_variable workAvailable;
+	condition_variable workFinished;
+	int queuedTasks; // tasks sitting in a queue
+	int pendingTasks; // tasks submitted but not finished yet
+	bool stopping;
+
+public:
+	ThreadPool();
+
+	ThreadPool(int numThreads);
+
+	~ThreadPool();
+
+	int getThreadCount();
+
+	void submit(function<void(int)> task);
+
+	void waitForAll();
+
+	void parallelFor(int count, int chunkSize, function<void(int begin, int end, int worker)> body);
+
+private:
+	void start(int numThreads);
+
+	void workerLoop(int worker);
+
+	bool takeTask(int worker, function<void(int)> *task);
+
+	// workers keep a pointer to the pool
+	ThreadPool(const ThreadPool &other) = delete;
+
+	ThreadPool &operator = (const ThreadPool &other) = delete;
+};
+
+/// <summary>
+/// Create a pool with one worker per hardware thread
+/// </summary>
+ThreadPool::ThreadPool()
+{
+	int numThreads = (int)thread::hardware_concurrency();
+	start(numThreads > 0 ? numThreads : 1);
+}
+
+/// <summary>
+/// Create a pool with the given number of workers
+/// </summary>
+/// <param name="numThreads">the number of worker threads</param>
+ThreadPool::ThreadPool(int numThreads)
+{
+	start(numThreads > 0 ? numThreads : 1);
+}
+
+/// <summary>
+/// Finish every submitted task and stop the workers
+/// </summary>
+ThreadPool::~ThreadPool()
+{
+	waitForAll();
+
+	{
+		lock_guard<mutex> guard(stateLock);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+
+	for (int i = 0; i < (int)workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	for (int i = 0; i < (int)queues.size(); i++)
+	{
+		delete(queues[i]);
+	}
+}
+
+/// <summary>
+/// Start the worker threads
+/// </summary>
+/// <param name="numThreads">the number of worker threads</param>
+void ThreadPool::start(int numThreads)
+{
+	nextQueue = 0;
+	queuedTasks = 0;
+	pendingTasks = 0;
+	stopping = false;
+
+	for (int i = 0; i < numThreads; i++)
+	{
+		queues.push_back(new WorkQueue());
+	}
+	for (int i = 0; i < numThreads; i++)
+	{
+		workers.push_back(thread(&ThreadPool::workerLoop, this, i));
+	}
+}
+
+/// <summary>
+/// Get the number of worker threads
+/// </summary>
+/// <returns>the number of worker threads</returns>
+int ThreadPool::getThreadCount()
+{
+	return (int)workers.size();
+}
+
+/// <summary>
+/// Queue a task to be run by one of the workers
+/// </summary>
+/// <param name="task">the task, which is given the index of the worker
+/// running it</param>
+void ThreadPool::submit(function<void(int)> task)
+{
+	{
+		lock_guard<mutex> guard(stateLock);
+		pendingTasks++;
+	}
+
+	// spread the tasks over the queues, idle workers steal the rest
+	WorkQueue* queue = queues[nextQueue++ % queues.size()];
+	{
+		lock_guard<mutex> guard(queue->lock);
+		queue->tasks.push_back(move(task));
+	}
+
+	{
+		lock_guard<mutex> guard(stateLock);
+		queuedTasks++;
+	}
+	workAvailable.notify_one();
+}
+
+/// <summary>
+/// Block until every submitted task has finished. Must not be called
+/// from inside a task.
+/// </summary>
+void ThreadPool::waitForAll()
+{
+	unique_lock<mutex> guard(stateLock);
+	workFinished.wait(guard, [this] { return pendingTasks == 0; });
+}
+
+/// <summary>
+/// Run body over [0, count) in chunks spread over the workers and
+/// block until all of them are done. Must not be called from inside a task.
+/// </summary>
+/// <param name="count">the number of items</param>
+/// <param name="chunkSize">the number of items per task</param>
+/// <param name="body">called with a range of items and the index of the
+/// worker running it</param>
+void ThreadPool::parallelFor(int count, int chunkSize, function<void(int begin, int end, int worker)> body)
+{
+	if (chunkSize < 1)
+	{
+		chunkSize = 1;
+	}
+
+	for (int begin = 0; begin < count; begin += chunkSize)
+	{
+		int end = min(begin + chunkSize, count);
+		submit([&body, begin, end](int worker) { body(begin, end, worker); });
+	}
+
+	waitForAll();
+}
+
+/// <summary>
+/// Run tasks until the pool is stopped
+/// </summary>
+/// <param name="worker">the index of this worker</param>
+void ThreadPool::workerLoop(int worker)
+{
+	while (true)
+	{
+		function<void(int)> task;
+		if (takeTask(worker, &task))
+		{
+			task(worker);
+
+			lock_guard<mutex> guard(stateLock);
+			pendingTasks--;
+			if (pendingTasks == 0)
+			{
+				workFinished.notify_all();
+			}
+			continue;
+		}
+
+		// sleep until there is something to take or the pool stops
+		unique_lock<mutex> guard(stateLock);
+		workAvailable.wait(guard, [this] { return stopping || queuedTasks > 0; });
+		if (stopping && queuedTasks <= 0)
+		{
+			return;
+		}
+	}
+}
+
+/// <summary>
+/// Take the newest task from this worker's queue, or steal the oldest
+/// task from another worker's queue if this one is empty
+/// </summary>
+/// <param name="worker">the index of the worker looking for a task</param>
+/// <param name="task">set to the task that was taken</param>
+/// <returns>true if a task was taken and false otherwise</returns>
+bool ThreadPool::takeTask(int worker, function<void(int)> *task)
+{
+	int numQueues = (int)queues.size();
+	for (int i = 0; i < numQueues; i++)
+	{
+		WorkQueue* queue = queues[(worker + i) % numQueues];
+		bool taken = false;
+		{
+			lock_guard<mutex> guard(queue->lock);
+			if (!queue->tasks.empty())
+			{
+				if (i == 0)
+				{
+					*task = move(queue->tasks.back());
+					queue->tasks.pop_back();
+				}
+				else
+				{
+					*task = move(queue->tasks.front());
+					queue->tasks.pop_front();
+				}
+				taken = true;
+			}
+		}
+
+		if (taken)
+		{
+			lock_guard<mutex> guard(stateLock);
+			queuedTasks--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+#endif